@@ -0,0 +1,214 @@
+#ifndef ANY_BOARD_H
+#define ANY_BOARD_H
+
+#include <chrono>
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "generator.h"
+#include "sudoku.h"
+
+/*
+ * Board of a size chosen at run time, for the interface. Holds one of the
+ * BasicBoard instantiations behind a small virtual interface, so that the
+ * solver itself keeps its geometry fixed at compile time. Copying an
+ * AnyBoard copies the board it holds.
+ */
+
+class AnyBoard {
+public:
+    typedef BoardBase::Heuristic Heuristic;
+    typedef BoardBase::Backend Backend;
+    typedef BoardBase::Result Result;
+
+    // Makes an empty board of box by box squares, box being 2 to 5
+    explicit AnyBoard(int box = 3) : m_board(make(box)) {}
+
+    AnyBoard(const AnyBoard& other) : m_board(other.m_board->clone()) {}
+    AnyBoard& operator=(const AnyBoard& other)
+    {
+        m_board = other.m_board->clone();
+        return *this;
+    }
+
+    int box() const { return m_board->box(); }
+    int size() const { return box() * box(); }
+
+    int at(int row, int col) const { return m_board->at(row, col); }
+    void set(int row, int col, int entry) { m_board->set(row, col, entry); }
+
+    std::string str() const { return m_board->str(); }
+    // Reads a board of this size in the format operator>> accepts
+    bool read(std::istream& is) { return m_board->read(is); }
+
+    // Replaces the board with a puzzle made by BasicGenerator from seed,
+    // with node_budget limiting each of its uniqueness checks
+    void generate(unsigned long long int seed, unsigned long int node_budget)
+    {
+        m_board->generate(seed, node_budget);
+    }
+
+    unsigned long int count() const { return m_board->count(); }
+    unsigned long int nodes() const { return m_board->nodes(); }
+
+    Heuristic heuristic() const { return m_board->heuristic(); }
+    void set_heuristic(Heuristic heuristic)
+    {
+        m_board->set_heuristic(heuristic);
+    }
+
+    Backend backend() const { return m_board->backend(); }
+    void set_backend(Backend backend) { m_board->set_backend(backend); }
+
+    void set_time_budget(std::chrono::milliseconds budget)
+    {
+        m_board->set_time_budget(budget);
+    }
+    void set_node_budget(unsigned long int budget)
+    {
+        m_board->set_node_budget(budget);
+    }
+
+    Result result() const { return m_board->result(); }
+
+    void set_collect_stats(bool collect)
+    {
+        m_board->set_collect_stats(collect);
+    }
+    const SolveStats& stats() const { return m_board->stats(); }
+
+    unsigned long int count_solutions(unsigned long int limit)
+    {
+        return m_board->count_solutions(limit);
+    }
+    unsigned long int count_solutions(unsigned long int limit,
+                                      ThreadPool& pool)
+    {
+        return m_board->count_solutions(limit, pool);
+    }
+
+    void clear() { m_board->clear(); }
+    void cancel() { m_board->cancel(); }
+    bool contradictory() { return m_board->contradictory(); }
+private:
+    struct Concept {
+        virtual ~Concept() {}
+        virtual std::unique_ptr<Concept> clone() const = 0;
+
+        virtual int box() const = 0;
+        virtual int at(int row, int col) const = 0;
+        virtual void set(int row, int col, int entry) = 0;
+        virtual std::string str() const = 0;
+        virtual bool read(std::istream& is) = 0;
+        virtual void generate(unsigned long long int seed,
+                              unsigned long int node_budget) = 0;
+        virtual unsigned long int count() const = 0;
+        virtual unsigned long int nodes() const = 0;
+        virtual Heuristic heuristic() const = 0;
+        virtual void set_heuristic(Heuristic heuristic) = 0;
+        virtual Backend backend() const = 0;
+        virtual void set_backend(Backend backend) = 0;
+        virtual void set_time_budget(std::chrono::milliseconds budget) = 0;
+        virtual void set_node_budget(unsigned long int budget) = 0;
+        virtual Result result() const = 0;
+        virtual void set_collect_stats(bool collect) = 0;
+        virtual const SolveStats& stats() const = 0;
+        virtual unsigned long int count_solutions(unsigned long int limit) = 0;
+        virtual unsigned long int count_solutions(unsigned long int limit,
+                                                  ThreadPool& pool) = 0;
+        virtual void clear() = 0;
+        virtual void cancel() = 0;
+        virtual bool contradictory() = 0;
+    };
+
+    template <int Box>
+    struct Model : Concept {
+        std::unique_ptr<Concept> clone() const override
+        {
+            return std::unique_ptr<Concept>(new Model(*this));
+        }
+
+        int box() const override { return Box; }
+        int at(int row, int col) const override { return board[row][col]; }
+        void set(int row, int col, int entry) override
+        {
+            board[row][col] = entry;
+        }
+        std::string str() const override { return board.str(); }
+        bool read(std::istream& is) override
+        {
+            // Keep the settings, which operator>> would reset
+            BasicBoard<Box> b;
+            if (!(is >> b)) return false;
+            b.set_heuristic(board.heuristic());
+            b.set_backend(board.backend());
+            board = b;
+            return true;
+        }
+        void generate(unsigned long long int seed,
+                      unsigned long int node_budget) override
+        {
+            BasicGenerator<Box> generator(seed);
+            generator.set_node_budget(node_budget);
+            BasicBoard<Box> b = generator.generate();
+            b.set_heuristic(board.heuristic());
+            b.set_backend(board.backend());
+            board = b;
+        }
+        unsigned long int count() const override { return board.count(); }
+        unsigned long int nodes() const override { return board.nodes(); }
+        Heuristic heuristic() const override { return board.heuristic(); }
+        void set_heuristic(Heuristic heuristic) override
+        {
+            board.set_heuristic(heuristic);
+        }
+        Backend backend() const override { return board.backend(); }
+        void set_backend(Backend backend) override
+        {
+            board.set_backend(backend);
+        }
+        void set_time_budget(std::chrono::milliseconds budget) override
+        {
+            board.set_time_budget(budget);
+        }
+        void set_node_budget(unsigned long int budget) override
+        {
+            board.set_node_budget(budget);
+        }
+        Result result() const override { return board.result(); }
+        void set_collect_stats(bool collect) override
+        {
+            board.set_collect_stats(collect);
+        }
+        const SolveStats& stats() const override { return board.stats(); }
+        unsigned long int count_solutions(unsigned long int limit) override
+        {
+            return board.count_solutions(limit);
+        }
+        unsigned long int count_solutions(unsigned long int limit,
+                                          ThreadPool& pool) override
+        {
+            return board.count_solutions(limit, pool);
+        }
+        void clear() override { board.clear(); }
+        void cancel() override { board.cancel(); }
+        bool contradictory() override { return board.contradictory(); }
+
+        BasicBoard<Box> board;
+    };
+
+    static std::unique_ptr<Concept> make(int box)
+    {
+        switch (box) {
+        case 2: return std::unique_ptr<Concept>(new Model<2>());
+        case 4: return std::unique_ptr<Concept>(new Model<4>());
+        case 5: return std::unique_ptr<Concept>(new Model<5>());
+        default: return std::unique_ptr<Concept>(new Model<3>());
+        }
+    }
+
+    std::unique_ptr<Concept> m_board;
+};
+
+#endif // ANY_BOARD_H
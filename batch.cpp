@@ -0,0 +1,952 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "sudoku.h"
+#include "generator.h"
+#include "logic.h"
+#include "packed.h"
+#include "portfolio.h"
+#include "solution_cache.h"
+#include "solve_stats.h"
+#include "thread_pool.h"
+#include "puzzle_reader.h"
+
+/*
+ * Headless batch solver. Reads puzzles written one per line as 81 digits
+ * (with '0' or '.' for unfilled squares), or in either nine line format,
+ * and writes one line per puzzle: the solution, "unsolvable", "gave up" (if
+ * a budget given with -t or -n ran out), or "bad input". Blank lines and
+ * lines starting with '#' are skipped. A summary is printed to stderr at
+ * the end. Packed files (see packed.h) are read as well, and with -b the
+ * solutions, unique puzzles or generated puzzles are written to one.
+ *
+ * Puzzles are read in chunks, held packed, and solved across a thread pool
+ * while the next chunk is read. Results are written back in input order.
+ * Puzzles equivalent to one solved earlier in the run are answered from a
+ * solution cache.
+ *
+ * With -s portfolio each puzzle is raced by several strategies at once (see
+ * portfolio.h), and the summary says how often each one won.
+ *
+ * With -m rate it instead rates each puzzle by the hardest technique the
+ * logic solver needed, and with -m explain writes every step it took.
+ *
+ * With -S, -T or -L it also times every solve and counts its search nodes,
+ * backtracks, depth and propagations (see solve_stats.h), writing them as
+ * CSV or as a Chrome trace, and reporting the puzzles slower than a latency
+ * objective. The summary then adds totals and latency percentiles.
+ *
+ * With -m all it writes every solution of each puzzle in turn, as the
+ * search finds them, holding only the current one (with -b, only to the
+ * packed file). -l stops the run after so many solutions, and -K saves
+ * where it stopped so that the next run with the same -K carries on from
+ * there.
+ *
+ * With -g it instead generates puzzles with unique solutions, one per line.
+ * Puzzle i is made from seed + i, so output doesn't depend on the number of
+ * threads.
+ */
+
+namespace {
+
+// Puzzles per chunk read from input, and per task given to the pool
+constexpr std::size_t chunk_size = 1 << 16;
+constexpr std::size_t task_size = 64;
+
+enum class Mode {
+    // Write the solution of every puzzle
+    solve,
+    // Write whether each puzzle has a unique solution, several, or none
+    check,
+    // Write only the puzzles that have a unique solution
+    unique,
+    // Write the rating of the hardest technique each puzzle needs
+    rate,
+    // Write the logic solver's steps through each puzzle
+    explain,
+    // Write every solution of each puzzle
+    all
+};
+
+// Solved means uniquely solved in the check and unique modes. Gave up means
+// the time or node budget ran out first.
+enum class Outcome : char { solved, multiple, unsolvable, gave_up, bad };
+
+struct Chunk {
+    std::vector<PackedBoard> puzzles;
+    std::size_t size = 0;
+
+    // Solution of each puzzle, 81 digits and a newline
+    std::vector<char> solutions;
+    std::vector<Outcome> outcomes;
+
+    // In the rate and explain modes, the logic solver's rating of each
+    // puzzle and the hardest technique it needed, and in the explain mode
+    // its steps, one per line
+    std::vector<int> ratings;
+    std::vector<LogicSolver::Technique> hardest;
+    std::vector<std::string> traces;
+
+    // While collecting stats, those of each solve and the worker that ran
+    // it
+    std::vector<SolveStats> stats;
+    std::vector<int> workers;
+};
+
+// Reads up to chunk_size puzzles, timing each while collecting stats.
+// Malformed records are kept as bad outcomes, and reported on stderr.
+// Returns false once the input is exhausted.
+bool read_chunk(PuzzleReader& reader, Chunk& chunk, bool collect)
+{
+    if (chunk.puzzles.size() < chunk_size) {
+        chunk.puzzles.resize(chunk_size);
+        chunk.solutions.resize(chunk_size * 82);
+        chunk.outcomes.resize(chunk_size);
+        chunk.ratings.resize(chunk_size);
+        chunk.hardest.resize(chunk_size);
+    }
+    if (collect && chunk.stats.size() < chunk_size) {
+        chunk.stats.resize(chunk_size);
+        chunk.workers.resize(chunk_size);
+    }
+
+    chunk.size = 0;
+    while (chunk.size < chunk_size) {
+        SolveStats::Clock::time_point begin;
+        if (collect) begin = SolveStats::Clock::now();
+        PuzzleReader::Status status = reader.next(chunk.puzzles[chunk.size]);
+        if (status == PuzzleReader::Status::end) break;
+        if (collect) {
+            SolveStats& stats = chunk.stats[chunk.size];
+            stats.parse_start = begin;
+            stats.parse_time = SolveStats::Clock::now() - begin;
+        }
+
+        if (status == PuzzleReader::Status::malformed) {
+            std::cerr << "Bad record at byte " << reader.error_offset()
+                      << '\n';
+            chunk.outcomes[chunk.size] = Outcome::bad;
+        } else {
+            chunk.outcomes[chunk.size] = Outcome::solved;
+        }
+        chunk.size++;
+    }
+    return chunk.size > 0;
+}
+
+// Solves puzzles [begin, end) of a chunk with the given board, or races
+// them on the given portfolio, going through the cache if there is one.
+// worker is recorded with the stats.
+void solve_range(Chunk& chunk, std::size_t begin, std::size_t end,
+                 Board& board, const Board& settings, Mode mode,
+                 std::chrono::milliseconds time_budget,
+                 unsigned long int node_budget, SolutionCache* cache,
+                 Portfolio<3>* portfolio, int worker)
+{
+    const bool collect = settings.collect_stats();
+
+    // A second solution is enough to rule out uniqueness, so there is no
+    // need to search any further
+    const unsigned long int limit = (mode == Mode::solve ? 1 : 2);
+    CanonicalForm form;
+
+    for (std::size_t i = begin; i < end; ++i) {
+        if (chunk.outcomes[i] == Outcome::bad) continue;
+
+        chunk.puzzles[i].unpack(board);
+        unsigned long int solutions = 0;
+        bool cached = (cache &&
+                       cache->find(board, limit, form, board, solutions));
+        Board::Result result = Board::Result::solved;
+        if (!cached && portfolio) {
+            solutions = portfolio->count_solutions(board, limit);
+            result = portfolio->result();
+        } else if (!cached) {
+            board.set_backend(settings.backend());
+            board.set_heuristic(settings.heuristic());
+            board.set_restart_unit(settings.restart_unit());
+            board.set_seed(settings.seed());
+            board.set_time_budget(time_budget);
+            board.set_node_budget(node_budget);
+            board.set_collect_stats(collect);
+            solutions = board.count_solutions(limit);
+            result = board.result();
+        }
+        // Holds the solution, and the stats of the search
+        const Board& solved = (portfolio && !cached) ?
+                              portfolio->solution() : board;
+
+        if (collect) {
+            // Answers from the cache took no search at all
+            SolveStats& stats = chunk.stats[i];
+            SolveStats::Clock::time_point parse_start = stats.parse_start;
+            SolveStats::Clock::duration parse_time = stats.parse_time;
+            if (cached) {
+                stats = SolveStats();
+                stats.start = SolveStats::Clock::now();
+                stats.solves = 1;
+            } else {
+                stats = solved.stats();
+            }
+            stats.parse_start = parse_start;
+            stats.parse_time = parse_time;
+            chunk.workers[i] = worker;
+        }
+
+        if (!cached) {
+            if (result == Board::Result::budget_exceeded) {
+                chunk.outcomes[i] = Outcome::gave_up;
+                continue;
+            }
+            if (cache) cache->insert(form, limit, solved, solutions);
+        }
+        if (mode != Mode::solve) {
+            chunk.outcomes[i] = (solutions == 0 ? Outcome::unsolvable :
+                                 solutions == 1 ? Outcome::solved :
+                                                  Outcome::multiple);
+            continue;
+        }
+        if (solutions == 0) {
+            chunk.outcomes[i] = Outcome::unsolvable;
+            continue;
+        }
+        chunk.outcomes[i] = Outcome::solved;
+        write_line(solved, &chunk.solutions[i * 82]);
+        chunk.solutions[i * 82 + 81] = '\n';
+    }
+}
+
+// Rates puzzles [begin, end) of a chunk with the given logic solver,
+// unpacking them into board
+void rate_range(Chunk& chunk, std::size_t begin, std::size_t end,
+                Board& board, LogicSolver& solver, Mode mode)
+{
+    solver.set_trace(mode == Mode::explain);
+
+    for (std::size_t i = begin; i < end; ++i) {
+        if (chunk.outcomes[i] == Outcome::bad) continue;
+
+        chunk.puzzles[i].unpack(board);
+        if (solver.solve(board) ==
+                LogicSolver::Result::unsolvable) {
+            chunk.outcomes[i] = Outcome::unsolvable;
+            continue;
+        }
+        chunk.outcomes[i] = Outcome::solved;
+        chunk.ratings[i] = solver.difficulty();
+        chunk.hardest[i] = solver.hardest();
+
+        if (mode == Mode::explain) {
+            std::string& trace = chunk.traces[i];
+            trace.clear();
+            for (const LogicSolver::Step& step : solver.steps()) {
+                trace += LogicSolver::describe(step);
+                trace += '\n';
+            }
+        }
+    }
+}
+
+// Packs a line of 81 digits, as write_line() writes them
+PackedBoard pack_line(const char* line)
+{
+    PackedBoard board;
+    for (int cell = 0; cell < 81; ++cell) {
+        board.set(cell, line[cell] - '0');
+    }
+    return board;
+}
+
+/*
+ * Stats of a whole run: totals, the latency of every solve for the
+ * percentiles, and the CSV and trace output, if asked for.
+ */
+
+struct RunStats {
+    SolveStats totals;
+    // Parse and solve time of every puzzle, in microseconds
+    std::vector<double> latencies;
+    double objective = 0;
+    unsigned long int over_objective = 0;
+
+    std::ofstream csv;
+    std::ofstream trace_file;
+    std::unique_ptr<TraceWriter> trace;
+
+    // Adds the solve of puzzle number (counting from 1), reporting it if it
+    // missed the objective
+    void add(unsigned long int number, const SolveStats& stats, int worker)
+    {
+        totals += stats;
+        double latency = microseconds(stats.total_time());
+        latencies.push_back(latency);
+
+        const std::string name = std::to_string(number);
+        if (csv.is_open()) write_stats_csv(csv, name, stats);
+        if (trace) trace->write(name, stats, worker);
+
+        if (objective > 0 && latency > objective) {
+            over_objective++;
+            std::cerr << "Puzzle " << number << " took " << latency
+                      << " us (" << stats.nodes << " nodes, "
+                      << stats.backtracks << " backtracks, depth "
+                      << stats.max_depth << ", " << stats.restarts
+                      << " restarts)\n";
+        }
+    }
+
+    void print_summary()
+    {
+        if (latencies.empty()) return;
+
+        const double solves = static_cast<double>(totals.solves);
+        std::cerr << "Per solve: " << totals.nodes / solves << " nodes, "
+                  << totals.backtracks / solves << " backtracks, "
+                  << totals.propagations / solves << " propagations, "
+                  << totals.restarts / solves << " restarts, "
+                  << "max depth " << totals.max_depth << '\n'
+                  << "Time: parse " << microseconds(totals.parse_time)
+                  << " us, validate " << microseconds(totals.validate_time)
+                  << " us, search " << microseconds(totals.search_time)
+                  << " us\n";
+
+        std::cerr << "Latency:";
+        const double percentiles[] = { 50, 90, 99, 99.9, 100 };
+        for (double percentile : percentiles) {
+            std::size_t rank = static_cast<std::size_t>(
+                percentile / 100 * (latencies.size() - 1) + 0.5);
+            std::nth_element(latencies.begin(), latencies.begin() + rank,
+                             latencies.end());
+            std::cerr << (percentile < 100 ? " p" : " max ");
+            if (percentile < 100) std::cerr << percentile << ' ';
+            std::cerr << latencies[rank] << " us";
+        }
+        std::cerr << '\n';
+        if (objective > 0) {
+            std::cerr << over_objective << " puzzles over " << objective
+                      << " us\n";
+        }
+    }
+};
+
+// Settings of the generator, for -g
+struct GenerateOptions {
+    unsigned long int count = 0;
+    unsigned long long int seed = 0;
+    int clues = 0;
+    unsigned long int difficulty = 0;
+};
+
+// Generates puzzles across the pool, a chunk at a time, and writes them in
+// the order of their seeds
+void generate_puzzles(const GenerateOptions& options,
+                      unsigned long int node_budget, bool quiet,
+                      PackedWriter* packed, ThreadPool& pool)
+{
+    std::vector<Generator> generators(pool.size());
+    for (Generator& generator : generators) {
+        generator.set_target_clues(options.clues);
+        generator.set_target_difficulty(options.difficulty);
+        generator.set_node_budget(node_budget);
+    }
+
+    std::vector<char> lines;
+    unsigned long int clues = 0;
+    auto begin_time = std::chrono::steady_clock::now();
+
+    for (unsigned long int first = 0; first < options.count;
+            first += chunk_size) {
+        std::size_t size = std::min<unsigned long int>(chunk_size,
+                                                       options.count - first);
+        lines.resize(size * 82);
+
+        for (std::size_t begin = 0; begin < size; begin += task_size) {
+            std::size_t end = std::min(begin + task_size, size);
+            pool.submit([&generators, &lines, &options, first, begin,
+                         end](int worker) {
+                Generator& generator = generators[worker];
+                for (std::size_t i = begin; i < end; ++i) {
+                    generator.seed(options.seed + first + i);
+                    write_line(generator.generate(), &lines[i * 82]);
+                    lines[i * 82 + 81] = '\n';
+                }
+            });
+        }
+        pool.wait();
+
+        for (std::size_t i = 0; i < size; ++i) {
+            const char* line = &lines[i * 82];
+            clues += 81 - std::count(line, line + 81, '0');
+            if (packed) packed->write(pack_line(line));
+        }
+        if (!quiet) std::cout.write(lines.data(), lines.size());
+    }
+    std::cout.flush();
+
+    auto end_time = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end_time - begin_time)
+                     .count();
+    std::cerr << options.count << " puzzles generated ("
+              << (options.count > 0 ? double(clues) / options.count : 0)
+              << " clues on average) in " << seconds << " s, "
+              << (seconds > 0 ? options.count / seconds : 0)
+              << " puzzles/sec\n";
+}
+
+// Settings of -m all
+struct EnumerateOptions {
+    // Solutions to write before stopping, 0 for all of them
+    unsigned long int limit = 0;
+    // Where to carry on from, and save to, if given
+    const char* checkpoint_name = nullptr;
+};
+
+// Reads the puzzle number and checkpoint saved by an earlier run of -m all,
+// leaving number 0 if there is no file. Returns false if there is a file
+// but it doesn't hold one.
+bool read_checkpoint(const char* name, unsigned long int& number,
+                     Board::Checkpoint& checkpoint)
+{
+    number = 0;
+    std::ifstream file(name);
+    if (!file) return true;
+
+    std::string word;
+    return file >> word >> number && word == "puzzle" && number > 0 &&
+           checkpoint.read(file);
+}
+
+// Writes the checkpoint beside the file and then moves it into place, so
+// that a run killed while writing leaves the previous one whole
+bool write_checkpoint(const char* name, unsigned long int number,
+                      const Board::Checkpoint& checkpoint)
+{
+    const std::string temporary = std::string(name) + ".tmp";
+    {
+        std::ofstream file(temporary);
+        file << "puzzle " << number << '\n';
+        checkpoint.write(file);
+        if (!file) return false;
+    }
+    return std::rename(temporary.c_str(), name) == 0;
+}
+
+// Writes every solution of each puzzle in turn, in the order the settings'
+// heuristic and value order find them, until options.limit have been
+// written, to packed only if it is given. A puzzle that runs out of budget
+// is reported and left. Returns false on a bad or unwritable checkpoint.
+bool enumerate_puzzles(PuzzleReader& reader, const Board& settings,
+                       const EnumerateOptions& options,
+                       std::chrono::milliseconds time_budget,
+                       unsigned long int node_budget, bool quiet,
+                       PackedWriter* packed)
+{
+    unsigned long int resume_number = 0;
+    Board::Checkpoint checkpoint;
+    if (options.checkpoint_name &&
+            !read_checkpoint(options.checkpoint_name, resume_number,
+                             checkpoint)) {
+        std::cerr << "Bad checkpoint " << options.checkpoint_name << '\n';
+        return false;
+    }
+
+    Board board;
+    PackedBoard puzzle;
+    char line[82];
+    line[81] = '\n';
+    unsigned long int number = 0, written = 0, gave_up = 0;
+    bool stopped = false;
+    auto begin_time = std::chrono::steady_clock::now();
+
+    PuzzleReader::Status status;
+    while (!stopped &&
+           (status = reader.next(puzzle)) != PuzzleReader::Status::end) {
+        ++number;
+        if (number < resume_number) continue;
+        if (status == PuzzleReader::Status::malformed) {
+            std::cerr << "Bad record at byte " << reader.error_offset()
+                      << '\n';
+            continue;
+        }
+
+        puzzle.unpack(board);
+        board.set_heuristic(settings.heuristic());
+        board.set_value_order(settings.value_order());
+        board.set_time_budget(time_budget);
+        board.set_node_budget(node_budget);
+        if (number == resume_number) {
+            if (!board.resume(checkpoint)) {
+                std::cerr << "Checkpoint doesn't fit puzzle " << number
+                          << '\n';
+                return false;
+            }
+        } else if (!board.begin_enumeration()) {
+            continue;
+        }
+
+        while (board.next_solution()) {
+            ++written;
+            // Packed solutions aren't written as text as well, which would
+            // cost more than finding them
+            if (packed) {
+                packed->write(board);
+            } else if (!quiet) {
+                write_line(board, line);
+                std::cout.write(line, sizeof(line));
+            }
+            if (written == options.limit) {
+                stopped = true;
+                break;
+            }
+        }
+        if (board.result() == Board::Result::budget_exceeded) {
+            std::cerr << "Gave up on puzzle " << number << '\n';
+            ++gave_up;
+        }
+    }
+    std::cout.flush();
+
+    if (options.checkpoint_name) {
+        if (stopped) {
+            if (!write_checkpoint(options.checkpoint_name, number,
+                                  board.checkpoint())) {
+                std::cerr << "Error writing file "
+                          << options.checkpoint_name << '\n';
+                return false;
+            }
+        } else {
+            // Every puzzle is done, so the next run starts afresh
+            std::remove(options.checkpoint_name);
+        }
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    double seconds =
+        std::chrono::duration<double>(end_time - begin_time).count();
+    std::cerr << written << " solutions";
+    if (gave_up > 0) std::cerr << ", gave up on " << gave_up << " puzzles";
+    if (stopped) std::cerr << ", stopped in puzzle " << number;
+    std::cerr << ", in " << seconds << " s";
+    if (seconds > 0) {
+        std::cerr << ", " << static_cast<unsigned long int>(written / seconds)
+                  << " solutions/sec";
+    }
+    std::cerr << '\n';
+    return true;
+}
+
+void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options] [file]\n"
+              << "Solves puzzles from file, or from standard input.\n\n"
+              << "Options:\n"
+              << "  -s first|fewest|dlx|portfolio\n"
+              << "                       solving strategy (default fewest),\n"
+              << "                       portfolio racing several at once\n"
+              << "  -m solve|check|unique|rate|explain|all\n"
+              << "                       write solutions (default), whether\n"
+              << "                       each solution is unique, only the\n"
+              << "                       puzzles with a unique solution, the\n"
+              << "                       hardest technique each puzzle needs\n"
+              << "                       and its rating, every step taken,\n"
+              << "                       or every solution of each puzzle\n"
+              << "  -l solutions         with -m all, stop after this many\n"
+              << "                       solutions\n"
+              << "  -K file              with -m all, carry on from the\n"
+              << "                       checkpoint in file if there is one,\n"
+              << "                       and save one there if stopped by -l\n"
+              << "  -j threads           worker threads (default one per core)\n"
+              << "  -t milliseconds      give up on a puzzle after this long\n"
+              << "  -n nodes             give up on a puzzle after this many\n"
+              << "                       search nodes\n"
+              << "  -g count             generate this many puzzles instead\n"
+              << "  -c clues             stop generating a puzzle once this\n"
+              << "                       few clues are left\n"
+              << "  -d difficulty        stop generating a puzzle once it\n"
+              << "                       needs this many search nodes\n"
+              << "  -R nodes             restart a search after this many\n"
+              << "                       nodes, then on a Luby schedule,\n"
+              << "                       choosing at random after the first\n"
+              << "  -r seed              seed of the first puzzle generated,\n"
+              << "                       and of the random choices of -R\n"
+              << "  -C puzzles           size of the solution cache, 0 to\n"
+              << "                       turn it off (default 65536)\n"
+              << "  -b file              also write the solutions, unique\n"
+              << "                       puzzles or generated puzzles to a\n"
+              << "                       packed file; with -m all, write\n"
+              << "                       the solutions only there\n"
+              << "  -S file              write the stats of every solve as\n"
+              << "                       CSV\n"
+              << "  -T file              write every solve as a Chrome trace\n"
+              << "  -L microseconds      report puzzles that take longer than\n"
+              << "                       this to read and solve\n"
+              << "  -q                   don't write solutions\n"
+              << "  -h                   show this help\n";
+}
+
+bool set_mode(const std::string& name, Mode& mode)
+{
+    if (name == "solve") {
+        mode = Mode::solve;
+    } else if (name == "check") {
+        mode = Mode::check;
+    } else if (name == "unique") {
+        mode = Mode::unique;
+    } else if (name == "rate") {
+        mode = Mode::rate;
+    } else if (name == "explain") {
+        mode = Mode::explain;
+    } else if (name == "all") {
+        mode = Mode::all;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Portfolio strategies leave board alone and set portfolio instead
+bool set_strategy(const std::string& name, Board& board, bool& portfolio)
+{
+    portfolio = false;
+    if (name == "portfolio") {
+        portfolio = true;
+    } else if (name == "first") {
+        board.set_backend(Board::Backend::backtracking);
+        board.set_heuristic(Board::Heuristic::first_empty);
+    } else if (name == "fewest") {
+        board.set_backend(Board::Backend::backtracking);
+        board.set_heuristic(Board::Heuristic::fewest_candidates);
+    } else if (name == "dlx") {
+        board.set_backend(Board::Backend::dancing_links);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::ios_base::sync_with_stdio(false);
+
+    // Holds the strategy that every puzzle is solved with
+    Board settings;
+    bool portfolio = false;
+    set_strategy("fewest", settings, portfolio);
+    Mode mode = Mode::solve;
+    bool quiet = false;
+    int threads = 0;
+    std::chrono::milliseconds time_budget(0);
+    unsigned long int node_budget = 0;
+    const char* file_name = nullptr;
+    GenerateOptions generate;
+    EnumerateOptions enumerate;
+    std::size_t cache_size = 1 << 16;
+    const char* packed_name = nullptr;
+    const char* csv_name = nullptr;
+    const char* trace_name = nullptr;
+    double latency_objective = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            if (!set_strategy(argv[++i], settings, portfolio)) {
+                std::cerr << "Unknown strategy: " << argv[i] << '\n';
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            if (!set_mode(argv[++i], mode)) {
+                std::cerr << "Unknown mode: " << argv[i] << '\n';
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            time_budget = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            node_budget = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            generate.count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            generate.clues = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            generate.difficulty = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            generate.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            settings.set_restart_unit(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            enumerate.limit = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            enumerate.checkpoint_name = argv[++i];
+        } else if (std::strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            cache_size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            packed_name = argv[++i];
+        } else if (std::strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            csv_name = argv[++i];
+        } else if (std::strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            trace_name = argv[++i];
+        } else if (std::strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            latency_objective = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (std::strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            file_name = argv[i];
+        }
+    }
+
+    PackedWriter packed;
+    if (packed_name) {
+        if (generate.count == 0 && mode != Mode::solve &&
+                mode != Mode::unique && mode != Mode::all) {
+            std::cerr << "-b needs -g, or -m solve, unique or all\n";
+            return 2;
+        }
+        if (!packed.open(packed_name)) {
+            std::cerr << "Error writing file " << packed_name << '\n';
+            return 1;
+        }
+    }
+
+    if (generate.count > 0) {
+        ThreadPool pool(threads);
+        generate_puzzles(generate, node_budget, quiet,
+                         packed_name ? &packed : nullptr, pool);
+        if (packed_name && !packed.close()) {
+            std::cerr << "Error writing file " << packed_name << '\n';
+            return 1;
+        }
+        return 0;
+    }
+
+    PuzzleReader reader;
+    if (!file_name) {
+        reader.open(stdin);
+    } else if (!reader.open(file_name)) {
+        std::cerr << "Error reading file " << file_name << '\n';
+        return 1;
+    }
+    // Packed files are checked against the checksums of their index first
+    if (file_name) {
+        PackedReader packed_input;
+        if (packed_input.open(file_name) && packed_input.indexed() &&
+                !packed_input.verify()) {
+            std::cerr << "Corrupt packed file " << file_name << '\n';
+            return 1;
+        }
+    }
+
+    if (mode == Mode::all) {
+        bool ok = enumerate_puzzles(reader, settings, enumerate, time_budget,
+                                    node_budget, quiet,
+                                    packed_name ? &packed : nullptr);
+        if (packed_name && !packed.close()) {
+            std::cerr << "Error writing file " << packed_name << '\n';
+            return 1;
+        }
+        return ok ? 0 : 1;
+    }
+
+    const bool rating = (mode == Mode::rate || mode == Mode::explain);
+    if (rating) portfolio = false;
+
+    // Each portfolio runs a thread per strategy, so there are fewer workers
+    // by default to share the cores between
+    const std::size_t portfolio_size =
+        Portfolio<3>::default_strategies().size();
+    if (portfolio && threads == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threads = std::max(1, static_cast<int>(cores / portfolio_size));
+    }
+    ThreadPool pool(threads);
+
+    // Stats are only collected when something will use them, and only the
+    // solving modes have them
+    RunStats run_stats;
+    const bool collect = !rating && (csv_name || trace_name ||
+                                     latency_objective > 0);
+    settings.set_collect_stats(collect);
+    settings.set_seed(generate.seed);
+    run_stats.objective = latency_objective;
+    if (csv_name) {
+        run_stats.csv.open(csv_name);
+        if (!run_stats.csv) {
+            std::cerr << "Error writing file " << csv_name << '\n';
+            return 1;
+        }
+        write_stats_csv_header(run_stats.csv);
+    }
+    if (trace_name) {
+        run_stats.trace_file.open(trace_name);
+        if (!run_stats.trace_file) {
+            std::cerr << "Error writing file " << trace_name << '\n';
+            return 1;
+        }
+        run_stats.trace.reset(new TraceWriter(run_stats.trace_file));
+    }
+
+    std::vector<Board> boards(pool.size());
+    std::vector<LogicSolver> solvers(rating ? pool.size() : 0);
+    std::unique_ptr<SolutionCache> cache;
+    if (cache_size > 0 && !rating) cache.reset(new SolutionCache(cache_size));
+    std::vector<std::unique_ptr<Portfolio<3>>> portfolios;
+    for (int i = 0; portfolio && i < pool.size(); ++i) {
+        portfolios.emplace_back(new Portfolio<3>());
+        portfolios.back()->set_time_budget(time_budget);
+        portfolios.back()->set_node_budget(node_budget);
+        portfolios.back()->set_collect_stats(collect);
+        portfolios.back()->set_seed(generate.seed);
+    }
+
+    unsigned long int solved = 0, multiple = 0, unsolvable = 0, gave_up = 0;
+    unsigned long int bad = 0, total_rating = 0;
+    char line[82];
+    line[81] = '\n';
+    auto begin_time = std::chrono::steady_clock::now();
+
+    // Solve one chunk while reading the next
+    Chunk chunks[2];
+    int current = 0;
+    unsigned long int read = 0;
+    bool more = read_chunk(reader, chunks[current], collect);
+    while (more) {
+        Chunk& chunk = chunks[current];
+        if (mode == Mode::explain) chunk.traces.resize(chunk.size);
+        for (std::size_t begin = 0; begin < chunk.size; begin += task_size) {
+            std::size_t end = std::min(begin + task_size, chunk.size);
+            pool.submit([&chunk, &boards, &solvers, &settings, &cache,
+                         &portfolios, rating, mode, time_budget, node_budget,
+                         begin, end](int worker) {
+                if (rating) {
+                    rate_range(chunk, begin, end, boards[worker],
+                               solvers[worker], mode);
+                    return;
+                }
+                solve_range(chunk, begin, end, boards[worker], settings,
+                            mode, time_budget, node_budget, cache.get(),
+                            portfolios.empty() ? nullptr :
+                                                 portfolios[worker].get(),
+                            worker);
+            });
+        }
+
+        more = read_chunk(reader, chunks[1 - current], collect);
+        pool.wait();
+
+        for (std::size_t i = 0; i < chunk.size; ++i) {
+            if (collect && chunk.outcomes[i] != Outcome::bad) {
+                run_stats.add(read + i + 1, chunk.stats[i], chunk.workers[i]);
+            }
+
+            switch (chunk.outcomes[i]) {
+            case Outcome::solved:
+                solved++;
+                if (rating) total_rating += chunk.ratings[i];
+                if (packed_name) {
+                    packed.write(mode == Mode::solve ?
+                                 pack_line(&chunk.solutions[i * 82]) :
+                                 chunk.puzzles[i]);
+                }
+                if (quiet) break;
+                if (mode == Mode::rate) {
+                    std::cout << chunk.ratings[i] / 10 << '.'
+                              << chunk.ratings[i] % 10 << ' '
+                              << (chunk.ratings[i] > 0 ?
+                                  LogicSolver::name(chunk.hardest[i]) :
+                                  "given")
+                              << '\n';
+                } else if (mode == Mode::explain) {
+                    std::cout << chunk.traces[i] << '\n';
+                } else if (mode == Mode::solve) {
+                    std::cout.write(&chunk.solutions[i * 82], 82);
+                } else if (mode == Mode::check) {
+                    std::cout << "unique\n";
+                } else {
+                    chunk.puzzles[i].unpack(boards[0]);
+                    write_line(boards[0], line);
+                    std::cout.write(line, sizeof(line));
+                }
+                break;
+            case Outcome::multiple:
+                multiple++;
+                if (!quiet && mode == Mode::check) std::cout << "multiple\n";
+                break;
+            case Outcome::unsolvable:
+                unsolvable++;
+                if (quiet || mode == Mode::unique) break;
+                std::cout << (mode == Mode::check ? "none\n" : "unsolvable\n");
+                break;
+            case Outcome::gave_up:
+                gave_up++;
+                if (!quiet && mode != Mode::unique) std::cout << "gave up\n";
+                break;
+            case Outcome::bad:
+                bad++;
+                if (!quiet && mode != Mode::unique) std::cout << "bad input\n";
+                break;
+            }
+        }
+        read += chunk.size;
+        current = 1 - current;
+    }
+    if (run_stats.trace) run_stats.trace->close();
+    std::cout.flush();
+    if (packed_name && !packed.close()) {
+        std::cerr << "Error writing file " << packed_name << '\n';
+        return 1;
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end_time - begin_time)
+                     .count();
+    unsigned long int total = solved + multiple + unsolvable + gave_up + bad;
+
+    std::cerr << total << " puzzles (";
+    if (mode == Mode::solve) {
+        std::cerr << solved << " solved, ";
+    } else if (rating) {
+        std::cerr << solved << " rated, ";
+    } else {
+        std::cerr << solved << " unique, " << multiple << " multiple, ";
+    }
+    std::cerr << unsolvable << " unsolvable, " << gave_up << " gave up, "
+              << bad << " bad) in "
+              << seconds << " s, "
+              << (seconds > 0 ? total / seconds : 0) << " puzzles/sec\n";
+    if (rating && solved > 0) {
+        std::cerr << "Mean rating " << total_rating / 10.0 / solved << '\n';
+    }
+    if (cache) {
+        std::cerr << "Cache: " << cache->hit_rate() * 100 << "% hit rate, "
+                  << cache->size() << " puzzles, "
+                  << cache->memory() / 1024 << " KiB\n";
+    }
+    if (!portfolios.empty()) {
+        std::cerr << "Portfolio wins:";
+        for (std::size_t i = 0; i < portfolio_size; ++i) {
+            unsigned long int wins = 0;
+            for (const auto& p : portfolios) wins += p->wins()[i];
+            std::cerr << (i == 0 ? " " : ", ")
+                      << portfolios[0]->strategies()[i].name << ' ' << wins;
+        }
+        std::cerr << '\n';
+    }
+    run_stats.print_summary();
+    return bad > 0 ? 1 : 0;
+}
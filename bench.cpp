@@ -0,0 +1,568 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <memory>
+
+#include "sudoku.h"
+#include "portfolio.h"
+#include "thread_pool.h"
+
+/*
+ * Benchmark of every solving strategy over a few corpora of puzzles. Each
+ * corpus starts from a handful of bundled puzzles and is grown to the
+ * requested size with random transformations that keep a puzzle's solution
+ * count (relabelling numbers, shuffling rows and columns within bands and
+ * stacks, shuffling bands and stacks, transposing), from a fixed seed so
+ * that every run solves the same puzzles.
+ *
+ * Each strategy solves each corpus over and over until a minimum time has
+ * passed, timing every solve. A table is printed to stdout and, with -o,
+ * the same results are written as JSON for comparing runs.
+ */
+
+namespace {
+
+// Allocations made since the program started, counted by the replacement
+// operator new below
+std::atomic<unsigned long int> allocations(0);
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+typedef std::array<std::array<int, 9>, 9> Grid;
+
+// Solvable in seconds by hand, mostly with singles
+const char* const easy_puzzles[] = {
+    "002040800470000053030206047000000000500703002060408010007090500300805001"
+    "020000080",
+    "530070000600195000098000060800060003400803001700020006060000280000419005"
+    "000080079",
+};
+
+// Well known hard puzzles, that need a lot of guessing
+const char* const hard_puzzles[] = {
+    "4.....8.5.3..........7......2.....6.....8.4......1.......6.3.7.5..2....."
+    "1.4......",
+    "52...6.........7.13...........4..8..6......5...........418.........3..2."
+    "..87.....",
+    "6.....8.3.4.7.................5.4.7.3..2.....1.6.......2.....5.....8.6.."
+    "....1....",
+    "48.3............71.2.......7.5....6....2..8.............1.76...3.....4.."
+    "....5....",
+    "....14....3....2...7..........9...3.6.1.............8.2.....1.4....5.6.."
+    "...7.8...",
+    "12.3....435....1....4........54..2..6...7.........8.9...31..5.......9.7."
+    "....6...8",
+    "1.......2.9.4...5...6...7...5.9.3.......7.......85..4.7.....6...3...9.8."
+    "..2.....1",
+};
+
+// Puzzles with the fewest clues a puzzle with a unique solution can have
+const char* const seventeen_puzzles[] = {
+    "000000010400000000020000000000050407008000300001090000300400200050100000"
+    "000806000",
+    "000000010400000000020000000000050604008000300001090000300400200050100000"
+    "000807000",
+    "000000012000035000000600070700000300000400800100000000000120000080000040"
+    "050000600",
+    "000000012003600000000007000410020000000500300700000600280000040000300500"
+    "000000000",
+    "000000012008030000000000040120500000000004700060000000507000300000620000"
+    "000100000",
+    "000000012040050000000009000070600400000100000000000050000087500601000300"
+    "200000000",
+    "000000012050400000000000030700600400001000000000080000920000800000510700"
+    "000003000",
+    "000000012300000060000040000900000500000001070020000000000350400001400800"
+    "060000000",
+};
+
+// Built so that the first row of the solution is 987654321, which is the
+// worst case for trying numbers in order on the first empty cell. The rest
+// of this corpus is relabelled in the same spirit, see make_anti().
+const char* const anti_puzzles[] = {
+    "..............3.85..1.2.......5.7.....4...1...9.......5......73..2.1...."
+    "....4...9",
+};
+
+struct Corpus {
+    const char* name;
+    std::vector<Board> puzzles;
+};
+
+// A way of solving a puzzle, as it is benchmarked
+struct Strategy {
+    const char* name;
+    Board::Backend backend;
+    Board::Heuristic heuristic;
+    // Whether the search of each puzzle is split across the thread pool
+    bool parallel;
+    // Whether each puzzle is raced by the default portfolio instead (see
+    // portfolio.h)
+    bool portfolio;
+    // Nodes before the first restart, 0 for none (see
+    // Board::set_restart_unit())
+    unsigned long int restart_unit;
+};
+
+const Strategy strategies[] = {
+    {"first", Board::Backend::backtracking, Board::Heuristic::first_empty,
+     false, false, 0},
+    {"fewest", Board::Backend::backtracking,
+     Board::Heuristic::fewest_candidates, false, false, 0},
+    {"fewest-restarts", Board::Backend::backtracking,
+     Board::Heuristic::fewest_candidates, false, false, 256},
+    {"dlx", Board::Backend::dancing_links,
+     Board::Heuristic::fewest_candidates, false, false, 0},
+    {"fewest-parallel", Board::Backend::backtracking,
+     Board::Heuristic::fewest_candidates, true, false, 0},
+    {"portfolio", Board::Backend::backtracking,
+     Board::Heuristic::fewest_candidates, false, true, 0},
+};
+
+struct Result {
+    std::string strategy;
+    std::string corpus;
+    std::size_t puzzles;
+    unsigned long int solves;
+    unsigned long int gave_up;
+    double ns_per_puzzle;
+    double nodes_per_sec;
+    double p50_ns;
+    double p99_ns;
+    double max_ns;
+    double allocations_per_solve;
+    // Races won by each strategy of the portfolio, such as "fewest 31,
+    // reversed 1"
+    std::string wins;
+};
+
+Grid to_grid(const Board& b)
+{
+    Grid grid;
+    for (int row = 0; row < 9; ++row) grid[row] = b[row];
+    return grid;
+}
+
+// Shuffles a puzzle into one with the same number of solutions
+Grid transform(const Grid& grid, std::mt19937& rng)
+{
+    std::array<int, 10> numbers = {{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}};
+    std::shuffle(numbers.begin() + 1, numbers.end(), rng);
+
+    // Source row and column of each row and column in the result
+    std::array<int, 9> rows, cols;
+    std::array<int, 3> bands = {{0, 1, 2}}, stacks = {{0, 1, 2}};
+    std::shuffle(bands.begin(), bands.end(), rng);
+    std::shuffle(stacks.begin(), stacks.end(), rng);
+    for (int i = 0; i < 3; ++i) {
+        std::array<int, 3> in_band = {{0, 1, 2}}, in_stack = {{0, 1, 2}};
+        std::shuffle(in_band.begin(), in_band.end(), rng);
+        std::shuffle(in_stack.begin(), in_stack.end(), rng);
+        for (int j = 0; j < 3; ++j) {
+            rows[i * 3 + j] = bands[i] * 3 + in_band[j];
+            cols[i * 3 + j] = stacks[i] * 3 + in_stack[j];
+        }
+    }
+    bool transpose = rng() & 1;
+
+    Grid result;
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int entry = transpose ? grid[cols[col]][rows[row]] :
+                                    grid[rows[row]][cols[col]];
+            result[row][col] = numbers[entry];
+        }
+    }
+    return result;
+}
+
+// Relabels a puzzle so that, reading its empty cells in row-major order,
+// the solution uses 9 first, then 8, and so on. Trying numbers from 1 up on
+// the first empty cell then backtracks as much as the puzzle allows.
+Grid make_anti(const Grid& grid)
+{
+    Board board(grid);
+    board.set_backend(Board::Backend::dancing_links);
+    board.solve();
+
+    std::array<int, 10> numbers = {};
+    int next = 9;
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int entry = board[row][col];
+            if (grid[row][col] == 0 && numbers[entry] == 0) {
+                numbers[entry] = next--;
+            }
+        }
+    }
+    for (int entry = 1; entry <= 9; ++entry) {
+        if (numbers[entry] == 0) numbers[entry] = next--;
+    }
+
+    Grid result;
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            result[row][col] = numbers[grid[row][col]];
+        }
+    }
+    return result;
+}
+
+// Reads the bundled puzzles and grows them into a corpus of size puzzles,
+// the bundled ones first
+template <std::size_t N>
+Corpus make_corpus(const char* name, const char* const (&bundled)[N],
+                   std::size_t size, bool anti, std::mt19937& rng)
+{
+    Corpus corpus;
+    corpus.name = name;
+
+    std::vector<Grid> sources;
+    for (const char* line : bundled) {
+        Board b;
+        read_line(line, std::strlen(line), b);
+        sources.push_back(to_grid(b));
+    }
+
+    for (std::size_t i = 0; i < size; ++i) {
+        Grid grid = sources[i % N];
+        if (i >= N) grid = transform(grid, rng);
+        if (anti) grid = make_anti(grid);
+        corpus.puzzles.push_back(Board(grid));
+    }
+    return corpus;
+}
+
+// Nearest rank percentile of sorted latencies
+double percentile(const std::vector<double>& sorted, double p)
+{
+    std::size_t rank = static_cast<std::size_t>(p * sorted.size() + 0.999);
+    return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+Result run(const Strategy& strategy, const Corpus& corpus, ThreadPool& pool,
+           std::chrono::milliseconds min_time,
+           std::chrono::milliseconds time_budget,
+           unsigned long int node_budget)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Result result;
+    result.strategy = strategy.name;
+    result.corpus = corpus.name;
+    result.puzzles = corpus.puzzles.size();
+    result.gave_up = 0;
+
+    std::vector<double> latencies;
+    latencies.reserve(corpus.puzzles.size());
+    unsigned long int nodes = 0;
+    unsigned long int allocated = 0;
+    Clock::duration total(0);
+
+    // Only started for the portfolio strategy, as it has threads of its own
+    std::unique_ptr<Portfolio<3>> portfolio;
+    if (strategy.portfolio) {
+        portfolio.reset(new Portfolio<3>());
+        portfolio->set_time_budget(time_budget);
+        portfolio->set_node_budget(node_budget);
+    }
+
+    // Whole passes over the corpus, so that every puzzle weighs the same
+    Board board;
+    do {
+        for (const Board& puzzle : corpus.puzzles) {
+            board = puzzle;
+            board.set_backend(strategy.backend);
+            board.set_heuristic(strategy.heuristic);
+            board.set_time_budget(time_budget);
+            board.set_node_budget(node_budget);
+            board.set_restart_unit(strategy.restart_unit);
+
+            unsigned long int allocations_before =
+                allocations.load(std::memory_order_relaxed);
+            Clock::time_point begin = Clock::now();
+            if (portfolio) {
+                portfolio->count_solutions(board, 1);
+            } else if (strategy.parallel) {
+                board.solve(pool);
+            } else {
+                board.solve();
+            }
+            Clock::duration elapsed = Clock::now() - begin;
+            allocated += allocations.load(std::memory_order_relaxed) -
+                         allocations_before;
+
+            total += elapsed;
+            Board::Result outcome = board.result();
+            if (portfolio) {
+                // Nodes of the winner alone, the others having been cut
+                // short
+                nodes += portfolio->solution().nodes();
+                outcome = portfolio->result();
+            } else {
+                nodes += board.nodes();
+            }
+            if (outcome == Board::Result::budget_exceeded) {
+                result.gave_up++;
+            }
+            latencies.push_back(
+                std::chrono::duration<double, std::nano>(elapsed).count());
+        }
+    } while (total < min_time);
+
+    double seconds = std::chrono::duration<double>(total).count();
+    result.solves = latencies.size();
+    result.ns_per_puzzle = seconds * 1e9 / result.solves;
+    result.nodes_per_sec = seconds > 0 ? nodes / seconds : 0;
+    result.allocations_per_solve =
+        static_cast<double>(allocated) / result.solves;
+
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_ns = percentile(latencies, 0.50);
+    result.p99_ns = percentile(latencies, 0.99);
+    result.max_ns = latencies.back();
+
+    if (portfolio) {
+        for (std::size_t i = 0; i < portfolio->wins().size(); ++i) {
+            if (portfolio->wins()[i] == 0) continue;
+            if (!result.wins.empty()) result.wins += ", ";
+            result.wins += portfolio->strategies()[i].name + ' ' +
+                           std::to_string(portfolio->wins()[i]);
+        }
+    }
+    return result;
+}
+
+void print_header()
+{
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right
+              << std::setw(12) << "ns/puzzle"
+              << std::setw(12) << "nodes/sec"
+              << std::setw(12) << "p50 ns"
+              << std::setw(12) << "p99 ns"
+              << std::setw(12) << "max ns"
+              << std::setw(10) << "allocs"
+              << std::setw(9) << "solves"
+              << std::setw(9) << "gave up" << '\n'
+              << std::string(124, '-') << '\n';
+}
+
+void print_result(const Result& r)
+{
+    std::cout << std::left << std::setw(36) << (r.strategy + '/' + r.corpus)
+              << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << r.ns_per_puzzle
+              << std::setw(12) << r.nodes_per_sec
+              << std::setw(12) << r.p50_ns
+              << std::setw(12) << r.p99_ns
+              << std::setw(12) << r.max_ns
+              << std::setprecision(1)
+              << std::setw(10) << r.allocations_per_solve
+              << std::setw(9) << r.solves
+              << std::setw(9) << r.gave_up << std::endl;
+    if (!r.wins.empty()) {
+        std::cout << "    won by " << r.wins << std::endl;
+    }
+}
+
+// Writes results in the layout of Google Benchmark's JSON output, with a
+// few extra fields per benchmark
+void write_json(std::ostream& os, const std::vector<Result>& results,
+                std::chrono::milliseconds time_budget,
+                unsigned long int node_budget)
+{
+    os << "{\n"
+       << "  \"context\": {\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+       << ",\n"
+       << "    \"time_budget_ms\": " << time_budget.count() << ",\n"
+       << "    \"node_budget\": " << node_budget << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n"
+       << "  \"benchmarks\": [";
+
+    os << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        os << (i == 0 ? "\n" : ",\n")
+           << "    {\n"
+           << "      \"name\": \"" << r.strategy << '/' << r.corpus << "\",\n"
+           << "      \"strategy\": \"" << r.strategy << "\",\n"
+           << "      \"corpus\": \"" << r.corpus << "\",\n"
+           << "      \"puzzles\": " << r.puzzles << ",\n"
+           << "      \"iterations\": " << r.solves << ",\n"
+           << "      \"gave_up\": " << r.gave_up << ",\n"
+           << "      \"time_unit\": \"ns\",\n"
+           << "      \"ns_per_puzzle\": " << r.ns_per_puzzle << ",\n"
+           << "      \"nodes_per_second\": " << r.nodes_per_sec << ",\n"
+           << "      \"p50_ns\": " << r.p50_ns << ",\n"
+           << "      \"p99_ns\": " << r.p99_ns << ",\n"
+           << "      \"max_ns\": " << r.max_ns << ",\n"
+           << "      \"allocations_per_solve\": "
+           << r.allocations_per_solve;
+        if (!r.wins.empty()) {
+            os << ",\n      \"portfolio_wins\": \"" << r.wins << '"';
+        }
+        os << "\n"
+           << "    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+// Whether name is in a comma separated filter, an empty filter matching
+// everything
+bool selected(const std::string& filter, const std::string& name)
+{
+    if (filter.empty()) return true;
+    std::istringstream is(filter);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        if (item == name) return true;
+    }
+    return false;
+}
+
+void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "Times every solving strategy over the bundled corpora.\n\n"
+              << "Options:\n"
+              << "  -s strategies   comma separated strategies to run, of\n"
+              << "                  first, fewest, fewest-restarts, dlx,\n"
+              << "                  fewest-parallel, portfolio\n"
+              << "                  (default all)\n"
+              << "  -c corpora      comma separated corpora to run, of easy,\n"
+              << "                  hard, 17-clue, anti-backtracking\n"
+              << "                  (default all)\n"
+              << "  -p puzzles      puzzles per corpus (default 32)\n"
+              << "  -r milliseconds minimum time per benchmark (default 500)\n"
+              << "  -t milliseconds give up on a puzzle after this long\n"
+              << "                  (default 1000)\n"
+              << "  -n nodes        give up on a puzzle after this many\n"
+              << "                  search nodes\n"
+              << "  -j threads      worker threads for fewest-parallel\n"
+              << "                  (default one per core)\n"
+              << "  -o file         also write the results as JSON\n"
+              << "  -h              show this help\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string strategy_filter, corpus_filter;
+    std::size_t size = 32;
+    std::chrono::milliseconds min_time(500);
+    std::chrono::milliseconds time_budget(1000);
+    unsigned long int node_budget = 0;
+    int threads = 0;
+    const char* json_name = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            strategy_filter = argv[++i];
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            corpus_filter = argv[++i];
+        } else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            size = std::max(1l, std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            min_time = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            time_budget = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            node_budget = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            json_name = argv[++i];
+        } else if (std::strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(1);
+    std::vector<Corpus> corpora;
+    corpora.push_back(make_corpus("easy", easy_puzzles, size, false, rng));
+    corpora.push_back(make_corpus("hard", hard_puzzles, size, false, rng));
+    corpora.push_back(make_corpus("17-clue", seventeen_puzzles, size, false,
+                                  rng));
+    corpora.push_back(make_corpus("anti-backtracking", anti_puzzles, size,
+                                  true, rng));
+
+    ThreadPool pool(threads);
+    std::vector<Result> results;
+
+    print_header();
+    for (const Strategy& strategy : strategies) {
+        if (!selected(strategy_filter, strategy.name)) continue;
+        for (const Corpus& corpus : corpora) {
+            if (!selected(corpus_filter, corpus.name)) continue;
+            results.push_back(run(strategy, corpus, pool, min_time,
+                                  time_budget, node_budget));
+            print_result(results.back());
+        }
+    }
+
+    if (json_name) {
+        std::ofstream file(json_name);
+        write_json(file, results, time_budget, node_budget);
+        if (!file) {
+            std::cerr << "Error writing file " << json_name << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <vector>
+
+#include "canonical.h"
+
+constexpr long CanonicalForm::max_orientations;
+
+namespace {
+
+typedef std::array<std::array<unsigned char, 9>, 9> Cells;
+typedef std::array<unsigned char, 9> Order;
+
+// The six orders of three things
+const int permutations[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+// Orders of the rows of cells that sort the bands by key and the rows
+// within each band by key, all of them where keys tie. Row keys count the
+// clues of a row and, for each clue, the clues of its column, which no
+// symmetry that keeps rows as rows changes.
+void sorted_orders(const Cells& cells, std::vector<Order>& orders)
+{
+    int col_clues[9] = {};
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            if (cells[row][col] != 0) col_clues[col]++;
+        }
+    }
+
+    long row_keys[9];
+    for (int row = 0; row < 9; ++row) {
+        long clues = 0, crossing = 0;
+        for (int col = 0; col < 9; ++col) {
+            if (cells[row][col] == 0) continue;
+            clues++;
+            crossing += col_clues[col];
+        }
+        row_keys[row] = clues * 100 + crossing;
+    }
+
+    // Bands are keyed by the sorted keys of their rows
+    long band_keys[3];
+    for (int band = 0; band < 3; ++band) {
+        long keys[3] = { row_keys[band * 3], row_keys[band * 3 + 1],
+                         row_keys[band * 3 + 2] };
+        std::sort(keys, keys + 3);
+        band_keys[band] = (keys[0] * 1000 + keys[1]) * 1000 + keys[2];
+    }
+
+    // Sorted orders of the rows within each band, as row indices
+    std::vector<std::array<int, 3>> band_orders[3];
+    for (int band = 0; band < 3; ++band) {
+        const long* keys = row_keys + band * 3;
+        for (const int* p : permutations) {
+            if (keys[p[0]] <= keys[p[1]] && keys[p[1]] <= keys[p[2]]) {
+                band_orders[band].push_back({{ band * 3 + p[0],
+                                               band * 3 + p[1],
+                                               band * 3 + p[2] }});
+            }
+        }
+    }
+
+    orders.clear();
+    for (const int* b : permutations) {
+        if (band_keys[b[0]] > band_keys[b[1]] ||
+                band_keys[b[1]] > band_keys[b[2]]) {
+            continue;
+        }
+        for (const auto& first : band_orders[b[0]]) {
+            for (const auto& second : band_orders[b[1]]) {
+                for (const auto& third : band_orders[b[2]]) {
+                    Order order;
+                    for (int i = 0; i < 3; ++i) {
+                        order[i] = first[i];
+                        order[i + 3] = second[i];
+                        order[i + 6] = third[i];
+                    }
+                    orders.push_back(order);
+                }
+            }
+        }
+    }
+}
+
+// Compares cells, read in the given orientation and relabelled in order of
+// first appearance, with best. If they are smaller, overwrites best and
+// returns true.
+bool improve(const Cells& cells, const Order& rows, const Order& cols,
+             CanonicalForm::Key& best)
+{
+    unsigned char labels[10] = {};
+    char next = '1';
+    bool smaller = false;
+    for (int row = 0; row < 9; ++row) {
+        const auto& line = cells[rows[row]];
+        for (int col = 0; col < 9; ++col) {
+            int number = line[cols[col]];
+            char label = '0';
+            if (number != 0) {
+                if (labels[number] == 0) labels[number] = next++;
+                label = labels[number];
+            }
+
+            char& current = best[row * 9 + col];
+            if (smaller) {
+                current = label;
+            } else if (label < current) {
+                smaller = true;
+                current = label;
+            } else if (label > current) {
+                return false;
+            }
+        }
+    }
+    return smaller;
+}
+
+} // namespace
+
+bool CanonicalForm::compute(const Board& board)
+{
+    m_valid = false;
+
+    Cells cells[2];
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int number = board[row][col];
+            if (number < 0 || number > 9) return false;
+            cells[0][row][col] = static_cast<unsigned char>(number);
+            cells[1][col][row] = static_cast<unsigned char>(number);
+        }
+    }
+
+    // Sorted orders of the rows and of the columns. The rows of the
+    // transpose are the columns of the original, so its orders swap.
+    std::vector<Order> orders[2];
+    sorted_orders(cells[0], orders[0]);
+    sorted_orders(cells[1], orders[1]);
+    if (2 * static_cast<long>(orders[0].size() * orders[1].size()) >
+            max_orientations) {
+        return false;
+    }
+
+    m_key.fill('9' + 1);
+    for (int transpose = 0; transpose < 2; ++transpose) {
+        const Cells& source = cells[transpose];
+        for (const Order& rows : orders[transpose]) {
+            for (const Order& cols : orders[1 - transpose]) {
+                if (improve(source, rows, cols, m_key)) {
+                    m_transpose = (transpose == 1);
+                    m_rows = rows;
+                    m_cols = cols;
+                }
+            }
+        }
+    }
+
+    // Label the numbers as the winning orientation reads them, then give
+    // the missing ones what is left
+    m_labels.fill(0);
+    int next = 1;
+    const Cells& source = cells[m_transpose ? 1 : 0];
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int number = source[m_rows[row]][m_cols[col]];
+            if (number != 0 && m_labels[number] == 0) {
+                m_labels[number] = static_cast<unsigned char>(next++);
+            }
+        }
+    }
+    for (int number = 1; number <= 9; ++number) {
+        if (m_labels[number] == 0) {
+            m_labels[number] = static_cast<unsigned char>(next++);
+        }
+    }
+    m_numbers[0] = 0;
+    for (int number = 1; number <= 9; ++number) {
+        m_numbers[m_labels[number]] = static_cast<unsigned char>(number);
+    }
+
+    // FNV-1a
+    m_hash = 14695981039346656037ull;
+    for (char c : m_key) {
+        m_hash = (m_hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+
+    m_valid = true;
+    return true;
+}
+
+void CanonicalForm::to_canonical(const Board& board, Key& out) const
+{
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int number = (m_transpose ? board[m_cols[col]][m_rows[row]] :
+                                        board[m_rows[row]][m_cols[col]]);
+            out[row * 9 + col] = static_cast<char>('0' + m_labels[number]);
+        }
+    }
+}
+
+void CanonicalForm::from_canonical(const Key& key, Board& out) const
+{
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int number = m_numbers[key[row * 9 + col] - '0'];
+            if (m_transpose) {
+                out[m_cols[col]][m_rows[row]] = number;
+            } else {
+                out[m_rows[row]][m_cols[col]] = number;
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <array>
+#include <cstdint>
+
+#include "sudoku.h"
+
+/*
+ * Canonical form of a 9 by 9 board under the symmetries that map puzzles
+ * onto equivalent ones: relabelling the numbers, permuting the bands and
+ * stacks, permuting the rows within a band and the columns within a stack,
+ * and transposing. Equivalent boards share their canonical form, and the
+ * form keeps the transformation it was reached by, so that a grid in the
+ * canonical orientation (such as a solution) can be mapped back.
+ *
+ * The form is the lexicographically smallest board among the orientations
+ * that sort bands, rows, stacks and columns by how many clues they hold and
+ * where, each relabelled in order of first appearance. Sorting by these
+ * invariants leaves few orientations to compare on most puzzles. On very
+ * symmetric boards, such as nearly empty ones, too many tie, and compute()
+ * gives up.
+ */
+
+class CanonicalForm {
+public:
+    // The canonical board, one character per cell like write_line()
+    typedef std::array<char, 81> Key;
+
+    // Most orientations compute() compares before giving up
+    static constexpr long max_orientations = 1 << 14;
+
+    CanonicalForm() : m_valid(false), m_hash(0) {}
+
+    // Finds the canonical form of board. Returns false if too many
+    // orientations tie, which holds for every board equivalent to it too.
+    bool compute(const Board& board);
+
+    bool valid() const { return m_valid; }
+    const Key& key() const { return m_key; }
+    // Hash of the key
+    std::uint64_t hash() const { return m_hash; }
+
+    // Maps a board of the original orientation to the canonical one, and
+    // back. Numbers missing from the original board are given the labels
+    // left over in increasing order, so both are one to one.
+    void to_canonical(const Board& board, Key& out) const;
+    void from_canonical(const Key& key, Board& out) const;
+private:
+    bool m_valid;
+    Key m_key;
+    std::uint64_t m_hash;
+
+    // Cell (row, col) of the canonical board comes from cell
+    // (m_rows[row], m_cols[col]) of the original, or of its transpose
+    bool m_transpose;
+    std::array<unsigned char, 9> m_rows;
+    std::array<unsigned char, 9> m_cols;
+
+    // Canonical label of each number, and the number of each label
+    std::array<unsigned char, 10> m_labels;
+    std::array<unsigned char, 10> m_numbers;
+};
+
+#endif // CANONICAL_H
@@ -0,0 +1,252 @@
+#include "dlx.h"
+
+template <int Box> constexpr int BasicDlx<Box>::size;
+template <int Box> constexpr int BasicDlx<Box>::cells;
+template <int Box> constexpr int BasicDlx<Box>::m_columns;
+template <int Box> constexpr int BasicDlx<Box>::m_options;
+template <int Box> constexpr int BasicDlx<Box>::m_root;
+template <int Box> constexpr int BasicDlx<Box>::m_first_option_node;
+
+template <int Box>
+BasicDlx<Box>::BasicDlx()
+    : m_nodes_pool(m_first_option_node + m_options * 4),
+      m_callback(nullptr), m_found(0), m_nodes(0), m_count(0),
+      m_cancel(nullptr), m_node_budget(0),
+      m_deadline(std::chrono::steady_clock::time_point::max()),
+      m_budget_exceeded(false)
+{
+    // Root and column headers form a circular list, each column's own
+    // vertical list starting out empty
+    for (int i = 0; i <= m_columns; ++i) {
+        Node& node = m_nodes_pool[i];
+        node.left = (i == 0 ? m_columns : i - 1);
+        node.right = (i == m_columns ? 0 : i + 1);
+        node.up = i;
+        node.down = i;
+        node.column = i;
+        m_sizes[i] = 0;
+    }
+
+    for (int option = 0; option < m_options; ++option) {
+        int cell = option / size;
+        int row = cell / size;
+        int col = cell % size;
+        int digit = option % size;
+        int box = (row / Box) * Box + col / Box;
+
+        // Header indices are offset by one for the root
+        const int columns[4] = {
+            1 + cell,
+            1 + cells + row * size + digit,
+            1 + 2 * cells + col * size + digit,
+            1 + 3 * cells + box * size + digit
+        };
+
+        for (int k = 0; k < 4; ++k) {
+            int index = option_node(option, k);
+            Node& node = m_nodes_pool[index];
+
+            node.left = option_node(option, (k + 3) % 4);
+            node.right = option_node(option, (k + 1) % 4);
+
+            // Append at the bottom of the column
+            Node& header = m_nodes_pool[columns[k]];
+            node.column = columns[k];
+            node.up = header.up;
+            node.down = columns[k];
+            m_nodes_pool[header.up].down = index;
+            header.up = index;
+            m_sizes[columns[k]]++;
+        }
+    }
+}
+
+template <int Box>
+unsigned long int BasicDlx<Box>::solve(const Grid& grid, Grid& solution,
+                             unsigned long int limit)
+{
+    bool have_solution = false;
+    Callback callback = [&](const Grid& found) {
+        if (!have_solution) {
+            solution = found;
+            have_solution = true;
+        }
+        return limit == 0 || m_found < limit;
+    };
+    return enumerate(grid, callback);
+}
+
+template <int Box>
+unsigned long int BasicDlx<Box>::enumerate(const Grid& grid,
+                                           const Callback& callback)
+{
+    m_nodes = 0;
+    m_count = 0;
+    m_found = 0;
+    m_budget_exceeded = false;
+
+    // Cover the givens, remembering how many were selected so that exactly
+    // those are undone afterwards
+    std::array<int, cells> givens;
+    int given_count = 0;
+    bool consistent = true;
+    for (int row = 0; row < size && consistent; ++row) {
+        for (int col = 0; col < size; ++col) {
+            if (grid[row][col] == 0) continue;
+
+            int option = (row * size + col) * size + grid[row][col] - 1;
+            if (!select(option)) {
+                consistent = false;
+                break;
+            }
+            givens[given_count++] = option;
+        }
+    }
+
+    if (consistent) {
+        m_grid = grid;
+        m_callback = &callback;
+        search(0);
+        m_callback = nullptr;
+    }
+
+    while (given_count > 0) {
+        deselect(givens[--given_count]);
+    }
+    return m_found;
+}
+
+template <int Box>
+bool BasicDlx<Box>::search(int depth)
+{
+    if (stopped()) {
+        return false;
+    }
+    m_nodes++;
+
+    if (m_nodes_pool[m_root].right == m_root) {
+        for (int i = 0; i < depth; ++i) {
+            int cell = m_chosen[i] / size;
+            m_grid[cell / size][cell % size] = m_chosen[i] % size + 1;
+        }
+        m_found++;
+        return (*m_callback)(m_grid);
+    }
+
+    // Branch on the constraint with the fewest remaining options
+    int column = m_nodes_pool[m_root].right;
+    for (int c = m_nodes_pool[column].right; c != m_root;
+         c = m_nodes_pool[c].right) {
+        if (m_sizes[c] < m_sizes[column]) {
+            column = c;
+            if (m_sizes[c] <= 1) break;
+        }
+    }
+    if (m_sizes[column] == 0) {
+        return true;
+    }
+
+    bool keep_going = true;
+    cover(column);
+    for (int r = m_nodes_pool[column].down; r != column && keep_going;
+         r = m_nodes_pool[r].down) {
+        m_count++;
+        m_chosen[depth] = (r - m_first_option_node) / 4;
+
+        for (int j = m_nodes_pool[r].right; j != r; j = m_nodes_pool[j].right) {
+            cover(m_nodes_pool[j].column);
+        }
+        keep_going = search(depth + 1);
+        for (int j = m_nodes_pool[r].left; j != r; j = m_nodes_pool[j].left) {
+            uncover(m_nodes_pool[j].column);
+        }
+    }
+    uncover(column);
+    return keep_going;
+}
+
+template <int Box>
+bool BasicDlx<Box>::stopped()
+{
+    if (m_cancel && m_cancel->load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (m_node_budget > 0 && m_nodes >= m_node_budget) {
+        m_budget_exceeded = true;
+    } else if ((m_nodes & 1023) == 0 && m_nodes > 0 &&
+               m_deadline != std::chrono::steady_clock::time_point::max() &&
+               std::chrono::steady_clock::now() >= m_deadline) {
+        // The clock is only looked at every 1024 nodes
+        m_budget_exceeded = true;
+    }
+    return m_budget_exceeded;
+}
+
+template <int Box>
+void BasicDlx<Box>::cover(int column)
+{
+    Node& header = m_nodes_pool[column];
+    m_nodes_pool[header.right].left = header.left;
+    m_nodes_pool[header.left].right = header.right;
+
+    for (int i = header.down; i != column; i = m_nodes_pool[i].down) {
+        for (int j = m_nodes_pool[i].right; j != i; j = m_nodes_pool[j].right) {
+            Node& node = m_nodes_pool[j];
+            m_nodes_pool[node.down].up = node.up;
+            m_nodes_pool[node.up].down = node.down;
+            m_sizes[node.column]--;
+        }
+    }
+}
+
+template <int Box>
+void BasicDlx<Box>::uncover(int column)
+{
+    Node& header = m_nodes_pool[column];
+    for (int i = header.up; i != column; i = m_nodes_pool[i].up) {
+        for (int j = m_nodes_pool[i].left; j != i; j = m_nodes_pool[j].left) {
+            Node& node = m_nodes_pool[j];
+            m_sizes[node.column]++;
+            m_nodes_pool[node.down].up = j;
+            m_nodes_pool[node.up].down = j;
+        }
+    }
+    m_nodes_pool[header.right].left = column;
+    m_nodes_pool[header.left].right = column;
+}
+
+template <int Box>
+bool BasicDlx<Box>::select(int option)
+{
+    // A column that has already been covered is no longer linked into the
+    // header list
+    for (int k = 0; k < 4; ++k) {
+        int column = m_nodes_pool[option_node(option, k)].column;
+        if (m_nodes_pool[m_nodes_pool[column].left].right != column) {
+            return false;
+        }
+    }
+
+    int node = option_node(option, 0);
+    cover(m_nodes_pool[node].column);
+    for (int j = m_nodes_pool[node].right; j != node;
+         j = m_nodes_pool[j].right) {
+        cover(m_nodes_pool[j].column);
+    }
+    return true;
+}
+
+template <int Box>
+void BasicDlx<Box>::deselect(int option)
+{
+    int node = option_node(option, 0);
+    for (int j = m_nodes_pool[node].left; j != node; j = m_nodes_pool[j].left) {
+        uncover(m_nodes_pool[j].column);
+    }
+    uncover(m_nodes_pool[node].column);
+}
+
+template class BasicDlx<2>;
+template class BasicDlx<3>;
+template class BasicDlx<4>;
+template class BasicDlx<5>;
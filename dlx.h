@@ -0,0 +1,117 @@
+#ifndef DLX_H
+#define DLX_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+/*
+ * Solves sudoku as an exact cover problem with Knuth's Dancing Links
+ * (Algorithm X). The options (a number placed in a cell, 729 of them for a
+ * 9 by 9 grid) and constraints (each cell, and each number in each row,
+ * column, and square, used exactly once, 324 of them) are built once, in a
+ * single contiguous pool of nodes. Givens are covered before searching and
+ * uncovered afterwards, so the same object can solve many grids without
+ * allocating. Box is the width of a square, as for BasicBoard.
+ */
+
+template <int Box>
+class BasicDlx {
+public:
+    static constexpr int size = Box * Box;
+    static constexpr int cells = size * size;
+
+    typedef std::array<std::array<int, size>, size> Grid;
+
+    // Called with every solution found. Return false to stop the search.
+    typedef std::function<bool(const Grid&)> Callback;
+
+    BasicDlx();
+
+    // Searches grid, storing the first solution found in solution. Stops
+    // after limit solutions, or searches exhaustively if limit is 0. Returns
+    // the number of solutions found.
+    unsigned long int solve(const Grid& grid, Grid& solution,
+                            unsigned long int limit = 1);
+
+    // Searches grid and calls callback with every solution found, until it
+    // returns false. Returns the number of solutions found.
+    unsigned long int enumerate(const Grid& grid, const Callback& callback);
+
+    // Number of search nodes visited, and options tried, by the last search
+    unsigned long int nodes() const { return m_nodes; }
+    unsigned long int count() const { return m_count; }
+
+    // Makes any running search exit as soon as *flag becomes true
+    void set_cancel_flag(const std::atomic<bool>* flag) { m_cancel = flag; }
+
+    // Makes searches give up after the given number of nodes (0 for no
+    // limit), or once the deadline has passed
+    void set_budget(unsigned long int nodes,
+                    std::chrono::steady_clock::time_point deadline)
+    {
+        m_node_budget = nodes;
+        m_deadline = deadline;
+    }
+
+    // Whether the last search gave up because of the budget
+    bool budget_exceeded() const { return m_budget_exceeded; }
+private:
+    struct Node {
+        int left, right, up, down;
+        int column;
+    };
+
+    static constexpr int m_columns = 4 * cells;
+    static constexpr int m_options = cells * size;
+    static constexpr int m_root = 0;
+    static constexpr int m_first_option_node = 1 + m_columns;
+
+    // Index of the node of option for a given constraint (0 to 3)
+    static int option_node(int option, int constraint)
+    {
+        return m_first_option_node + option * 4 + constraint;
+    }
+
+    void cover(int column);
+    void uncover(int column);
+
+    // Covers the columns of a given. Returns false if the given clashes with
+    // an earlier one.
+    bool select(int option);
+    void deselect(int option);
+
+    // Recursive search. Returns false once the search should stop.
+    bool search(int depth);
+
+    // Whether a running search should give up
+    bool stopped();
+
+    std::vector<Node> m_nodes_pool;
+    std::array<int, m_columns + 1> m_sizes;
+
+    // Options chosen at each depth of the current search
+    std::array<int, cells> m_chosen;
+    Grid m_grid;
+    const Callback* m_callback;
+    unsigned long int m_found;
+
+    unsigned long int m_nodes;
+    unsigned long int m_count;
+    const std::atomic<bool>* m_cancel;
+
+    unsigned long int m_node_budget;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_budget_exceeded;
+};
+
+extern template class BasicDlx<2>;
+extern template class BasicDlx<3>;
+extern template class BasicDlx<4>;
+extern template class BasicDlx<5>;
+
+typedef BasicDlx<3> Dlx;
+
+#endif // DLX_H
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+#include "generator.h"
+
+template <int Box>
+BasicGenerator<Box>::BasicGenerator(unsigned long long int seed)
+    : m_rng(seed), m_target_clues(0), m_target_difficulty(0),
+      m_node_budget(0)
+{
+    m_scratch.set_heuristic(BoardBase::Heuristic::fewest_candidates);
+}
+
+template <int Box>
+BasicBoard<Box> BasicGenerator<Box>::solution()
+{
+    constexpr int size = BasicBoard<Box>::size;
+    std::array<int, size> numbers;
+    std::iota(numbers.begin(), numbers.end(), 1);
+
+    // Shuffled squares are completed by the solver. Should a filling turn
+    // out to have no completion, another one is drawn.
+    m_scratch.set_node_budget(0);
+    do {
+        m_scratch.clear();
+        for (int square = 0; square < Box; ++square) {
+            std::shuffle(numbers.begin(), numbers.end(), m_rng);
+            for (int i = 0; i < size; ++i) {
+                m_scratch[square * Box + i / Box][square * Box + i % Box] =
+                    numbers[i];
+            }
+        }
+    } while (m_scratch.count_solutions(1) == 0);
+
+    BasicBoard<Box> board;
+    for (int row = 0; row < size; ++row) {
+        board[row] = m_scratch[row];
+    }
+    return board;
+}
+
+template <int Box>
+BasicBoard<Box> BasicGenerator<Box>::generate()
+{
+    constexpr int size = BasicBoard<Box>::size;
+    constexpr int cells = BasicBoard<Box>::cells;
+    BasicBoard<Box> puzzle = solution();
+
+    std::array<int, cells> order;
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), m_rng);
+
+    int clues = cells;
+    for (int cell : order) {
+        if (clues <= m_target_clues) break;
+
+        int& entry = puzzle[cell / size][cell % size];
+        int removed = entry;
+        entry = 0;
+        if (!unique(puzzle)) {
+            entry = removed;
+            continue;
+        }
+        clues--;
+
+        // The check that just passed solved the puzzle as difficulty() does
+        if (m_target_difficulty != 0 &&
+                m_scratch.nodes() >= m_target_difficulty) {
+            break;
+        }
+    }
+    return puzzle;
+}
+
+template <int Box>
+unsigned long int BasicGenerator<Box>::difficulty(
+    const BasicBoard<Box>& puzzle)
+{
+    BasicBoard<Box> board(puzzle);
+    board.set_heuristic(BoardBase::Heuristic::fewest_candidates);
+    board.set_backend(BoardBase::Backend::backtracking);
+    board.set_time_budget(std::chrono::milliseconds(0));
+    board.set_node_budget(0);
+    if (board.count_solutions(2) != 1) return 0;
+    return board.nodes();
+}
+
+template <int Box>
+bool BasicGenerator<Box>::unique(const BasicBoard<Box>& puzzle)
+{
+    for (int row = 0; row < BasicBoard<Box>::size; ++row) {
+        m_scratch[row] = puzzle[row];
+    }
+    m_scratch.set_node_budget(m_node_budget);
+    return m_scratch.count_solutions(2) == 1 &&
+           m_scratch.result() != BoardBase::Result::budget_exceeded;
+}
+
+template class BasicGenerator<2>;
+template class BasicGenerator<3>;
+template class BasicGenerator<4>;
+template class BasicGenerator<5>;
@@ -0,0 +1,75 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <random>
+
+#include "sudoku.h"
+
+/*
+ * Makes puzzles with exactly one solution. A random complete grid is built
+ * by filling the squares on the diagonal, which don't constrain each other,
+ * with shuffled numbers and solving for the rest. Clues are then taken away
+ * in random order, each one only if the puzzle stays uniquely solvable,
+ * which every check settles by stopping at a second solution.
+ *
+ * Difficulty is the number of search nodes the fewest candidates solver
+ * needs to solve a puzzle and rule out a second solution, so a puzzle that
+ * singles alone solve scores 1. Generators hold their own random number
+ * engine, so one per thread can run concurrently, and a given seed always
+ * makes the same puzzle.
+ */
+
+template <int Box>
+class BasicGenerator {
+public:
+    explicit BasicGenerator(unsigned long long int seed = 0);
+
+    void seed(unsigned long long int seed) { m_rng.seed(seed); }
+
+    // Stop taking clues away once this many are left. 0 means carry on
+    // until no clue can be taken away.
+    void set_target_clues(int clues) { m_target_clues = clues; }
+
+    // Stop taking clues away once the puzzle scores at least this on
+    // difficulty(). 0 means no target.
+    void set_target_difficulty(unsigned long int difficulty)
+    {
+        m_target_difficulty = difficulty;
+    }
+
+    // Search node budget of each uniqueness check. A check that runs out
+    // counts as finding a second solution, so the clue stays. 0 means no
+    // limit.
+    void set_node_budget(unsigned long int budget) { m_node_budget = budget; }
+
+    // A random complete grid
+    BasicBoard<Box> solution();
+
+    // A random puzzle with exactly one solution
+    BasicBoard<Box> generate();
+
+    // Search nodes needed to solve a puzzle and prove the solution unique,
+    // or 0 if it has no solution or several
+    static unsigned long int difficulty(const BasicBoard<Box>& puzzle);
+private:
+    // Whether puzzle has exactly one solution, searching on m_scratch
+    bool unique(const BasicBoard<Box>& puzzle);
+
+    std::mt19937_64 m_rng;
+    int m_target_clues;
+    unsigned long int m_target_difficulty;
+    unsigned long int m_node_budget;
+
+    // Board the checks search on, kept to avoid setting one up every time
+    BasicBoard<Box> m_scratch;
+};
+
+extern template class BasicGenerator<2>;
+extern template class BasicGenerator<3>;
+extern template class BasicGenerator<4>;
+extern template class BasicGenerator<5>;
+
+// Generator of classic 9 by 9 puzzles
+typedef BasicGenerator<3> Generator;
+
+#endif // GENERATOR_H
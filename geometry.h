@@ -0,0 +1,132 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <type_traits>
+
+/*
+ * Bit tricks and lookup tables for the shape of a board made of Box by Box
+ * squares, shared by the solvers. Cells are numbered row*size+col. Units are
+ * numbered rows first, then columns, then squares, so units 0-8 of a 9 by 9
+ * board are its rows, 9-17 its columns, and 18-26 its squares.
+ */
+
+// Index of the lowest set bit of a non-zero mask
+inline int lowest_bit(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Index of the highest set bit of a non-zero mask
+inline int highest_bit(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(mask);
+#else
+    int index = 0;
+    while (mask >>= 1) ++index;
+    return index;
+#endif
+}
+
+// Number of set bits in a mask
+inline int bit_count(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+// Square holding a cell (as row*size+col)
+template <int Box>
+constexpr int box_of(int cell)
+{
+    return (cell / (Box * Box * Box)) * Box + (cell % (Box * Box)) / Box;
+}
+
+// Cell (as row*size+col) at position i of a unit
+template <int Box>
+constexpr int unit_cell(int unit, int i)
+{
+    const int size = Box * Box;
+    if (unit < size) return unit * size + i;
+    if (unit < 2 * size) return i * size + (unit - size);
+    unit -= 2 * size;
+    return ((unit / Box) * Box + i / Box) * size + (unit % Box) * Box +
+           i % Box;
+}
+
+// Lookup tables for the geometry of a board with Box by Box squares, worked
+// out at compile time
+template <int Box>
+struct Geometry {
+    static constexpr int size = Box * Box;
+    static constexpr int cells = size * size;
+    static constexpr int units = 3 * size;
+    // Other cells sharing a row, column, or square with a cell (20 of them
+    // on a 9 by 9 board)
+    static constexpr int peer_count = 2 * (size - 1) + (Box - 1) * (Box - 1);
+
+    typedef typename std::conditional<(cells < 256), unsigned char,
+                                      unsigned short>::type Index;
+
+    Index peers[cells][peer_count];
+    // Row, column, and square unit of each cell
+    Index units_of[cells][3];
+    Index unit_cells[units][size];
+};
+
+template <int Box>
+constexpr Geometry<Box> make_geometry()
+{
+    typedef typename Geometry<Box>::Index Index;
+    const int size = Box * Box;
+
+    Geometry<Box> g = {};
+    for (int unit = 0; unit < 3 * size; ++unit) {
+        for (int i = 0; i < size; ++i) {
+            g.unit_cells[unit][i] = static_cast<Index>(unit_cell<Box>(unit, i));
+        }
+    }
+
+    for (int cell = 0; cell < size * size; ++cell) {
+        const int row = cell / size;
+        const int col = cell % size;
+        const int box = box_of<Box>(cell);
+        g.units_of[cell][0] = static_cast<Index>(row);
+        g.units_of[cell][1] = static_cast<Index>(size + col);
+        g.units_of[cell][2] = static_cast<Index>(2 * size + box);
+
+        int count = 0;
+        for (int i = 0; i < size; ++i) {
+            if (i != col) g.peers[cell][count++] = static_cast<Index>(
+                row * size + i);
+            if (i != row) g.peers[cell][count++] = static_cast<Index>(
+                i * size + col);
+        }
+        for (int i = 0; i < size; ++i) {
+            int peer = unit_cell<Box>(2 * size + box, i);
+            if (peer / size != row && peer % size != col) {
+                g.peers[cell][count++] = static_cast<Index>(peer);
+            }
+        }
+    }
+    return g;
+}
+
+template <int Box>
+constexpr Geometry<Box> geometry = make_geometry<Box>();
+
+#endif // GEOMETRY_H
@@ -0,0 +1,92 @@
+#include "live_grid.h"
+
+LiveGrid::LiveGrid(int box)
+    : m_box(box), m_size(box * box), m_cells(m_size * m_size, 0),
+      m_counts(3 * m_size * (m_size + 1), 0), m_present(3 * m_size, 0),
+      m_conflicts(0), m_bad(0), m_filled(0), m_revision(0)
+{}
+
+void LiveGrid::set(int row, int col, int entry)
+{
+    int& cell = m_cells[row * m_size + col];
+    if (cell == entry) return;
+
+    if (cell > 0) {
+        remove(row_unit(row), cell);
+        remove(col_unit(col), cell);
+        remove(box_unit(row, col), cell);
+        m_filled--;
+    } else if (cell < 0) {
+        m_bad--;
+    }
+
+    cell = entry;
+    if (entry > 0) {
+        add(row_unit(row), entry);
+        add(col_unit(col), entry);
+        add(box_unit(row, col), entry);
+        m_filled++;
+    } else if (entry < 0) {
+        m_bad++;
+    }
+    m_revision++;
+}
+
+void LiveGrid::reset(int box)
+{
+    m_box = box;
+    m_size = box * box;
+    m_cells.assign(m_size * m_size, 0);
+    m_counts.assign(3 * m_size * (m_size + 1), 0);
+    m_present.assign(3 * m_size, 0);
+    m_conflicts = 0;
+    m_bad = 0;
+    m_filled = 0;
+    m_revision++;
+}
+
+LiveGrid::Mask LiveGrid::candidates(int row, int col) const
+{
+    if (m_cells[row * m_size + col] > 0) return 0;
+
+    const Mask all = (Mask(1) << m_size) - 1;
+    return all & ~(m_present[row_unit(row)] | m_present[col_unit(col)] |
+                   m_present[box_unit(row, col)]);
+}
+
+bool LiveGrid::conflicted(int row, int col) const
+{
+    int entry = m_cells[row * m_size + col];
+    if (entry <= 0) return false;
+
+    return m_counts[row_unit(row) * (m_size + 1) + entry] > 1 ||
+           m_counts[col_unit(col) * (m_size + 1) + entry] > 1 ||
+           m_counts[box_unit(row, col) * (m_size + 1) + entry] > 1;
+}
+
+bool LiveGrid::dead_end() const
+{
+    for (int row = 0; row < m_size; ++row) {
+        for (int col = 0; col < m_size; ++col) {
+            if (m_cells[row * m_size + col] <= 0 &&
+                    candidates(row, col) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void LiveGrid::add(int unit, int entry)
+{
+    int& count = m_counts[unit * (m_size + 1) + entry];
+    if (++count == 2) m_conflicts++;
+    m_present[unit] |= Mask(1) << (entry - 1);
+}
+
+void LiveGrid::remove(int unit, int entry)
+{
+    int& count = m_counts[unit * (m_size + 1) + entry];
+    if (count-- == 2) m_conflicts--;
+    if (count == 0) m_present[unit] &= ~(Mask(1) << (entry - 1));
+}
@@ -0,0 +1,90 @@
+#ifndef LIVE_GRID_H
+#define LIVE_GRID_H
+
+#include <vector>
+
+/*
+ * Grid being typed into, for the interface. Keeps how many times each
+ * number appears in each unit (row, column and square), so that changing
+ * one cell only touches its three units, and the conflicts and candidates
+ * of any cell can be read off at once without rebuilding a board. Unlike
+ * BasicBoard its size is chosen at run time, like AnyBoard's.
+ */
+
+class LiveGrid {
+public:
+    // Bit n-1 stands for the number n
+    typedef unsigned int Mask;
+
+    // Makes an empty grid of box by box squares
+    explicit LiveGrid(int box = 3);
+
+    int box() const { return m_box; }
+    int size() const { return m_size; }
+
+    // Number in a cell, 0 for an unfilled one or one holding bad input
+    int at(int row, int col) const
+    {
+        int entry = m_cells[row * m_size + col];
+        return entry > 0 ? entry : 0;
+    }
+
+    // Changes one cell. entry is 0 to size(), or -1 for input that isn't a
+    // number in range, which leaves the cell unfilled but counts against
+    // the grid in bad_inputs().
+    void set(int row, int col, int entry);
+    void clear() { reset(m_box); }
+    // Empties the grid and changes its size. The revision carries on
+    // counting up rather than starting again.
+    void reset(int box);
+
+    // Numbers an unfilled cell could take given its units, or 0 for a
+    // filled one
+    Mask candidates(int row, int col) const;
+    // Whether a cell's number appears again in one of its units
+    bool conflicted(int row, int col) const;
+    bool bad(int row, int col) const
+    {
+        return m_cells[row * m_size + col] < 0;
+    }
+
+    // Numbers repeated in a unit, counted once per unit and number
+    int conflicts() const { return m_conflicts; }
+    int bad_inputs() const { return m_bad; }
+    int filled() const { return m_filled; }
+    // Whether some unfilled cell has no candidates left. Looks at every
+    // cell, which is still only a few hundred mask operations.
+    bool dead_end() const;
+
+    // Changes every time a cell does, so that work started on an older
+    // grid can be recognised as stale
+    unsigned long long int revision() const { return m_revision; }
+private:
+    // Units of a cell, numbered as in geometry.h: rows, then columns, then
+    // squares
+    int row_unit(int row) const { return row; }
+    int col_unit(int col) const { return m_size + col; }
+    int box_unit(int row, int col) const
+    {
+        return 2 * m_size + row / m_box * m_box + col / m_box;
+    }
+
+    // Adds or takes away one of entry in a unit
+    void add(int unit, int entry);
+    void remove(int unit, int entry);
+
+    int m_box;
+    int m_size;
+    std::vector<int> m_cells;
+    // Times each number appears in each unit, size()+1 counts to a unit
+    std::vector<int> m_counts;
+    // Numbers present in each unit
+    std::vector<Mask> m_present;
+
+    int m_conflicts;
+    int m_bad;
+    int m_filled;
+    unsigned long long int m_revision;
+};
+
+#endif // LIVE_GRID_H
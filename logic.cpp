@@ -0,0 +1,481 @@
+#include <sstream>
+
+#include "geometry.h"
+#include "logic.h"
+
+template <int Box>
+constexpr typename BasicLogicSolver<Box>::Mask
+BasicLogicSolver<Box>::all_entries;
+
+template <int Box>
+BasicLogicSolver<Box>::BasicLogicSolver()
+    : m_cells(), m_candidates(), m_placed(), m_empty(0),
+      m_contradiction(false), m_trace(false), m_result(Result::unsolvable),
+      m_difficulty(0), m_hardest(Technique::hidden_single), m_uses()
+{}
+
+template <int Box>
+typename BasicLogicSolver<Box>::Result
+BasicLogicSolver<Box>::solve(const BasicBoard<Box>& puzzle)
+{
+    m_cells.fill(0);
+    m_candidates.fill(all_entries);
+    m_placed.fill(0);
+    m_empty = cells;
+    m_contradiction = false;
+    m_difficulty = 0;
+    m_hardest = Technique::hidden_single;
+    m_uses.fill(0);
+    m_steps.clear();
+
+    m_result = Result::unsolvable;
+    for (int cell = 0; cell < cells; ++cell) {
+        int entry = puzzle[cell / size][cell % size];
+        if (entry == 0) continue;
+        if (entry < 0 || entry > size ||
+                !(m_candidates[cell] & (1u << (entry - 1)))) {
+            return m_result;
+        }
+        place(cell, entry);
+    }
+
+    while (m_empty > 0) {
+        bool progress = hidden_singles() || naked_singles();
+        if (m_contradiction) return m_result;
+        if (progress) continue;
+
+        if (locked_candidates() ||
+                naked_subset(2) || fish(2) || hidden_subset(2) ||
+                naked_subset(3) || fish(3) || hidden_subset(3)) {
+            continue;
+        }
+
+        search();
+        return m_result;
+    }
+    m_result = Result::solved;
+    return m_result;
+}
+
+template <int Box>
+BasicBoard<Box> BasicLogicSolver<Box>::board() const
+{
+    BasicBoard<Box> b;
+    for (int cell = 0; cell < cells; ++cell) {
+        b[cell / size][cell % size] = m_cells[cell];
+    }
+    return b;
+}
+
+template <int Box>
+const char* BasicLogicSolver<Box>::name(Technique technique)
+{
+    switch (technique) {
+    case Technique::hidden_single: return "hidden single";
+    case Technique::naked_single: return "naked single";
+    case Technique::locked_candidates: return "locked candidates";
+    case Technique::naked_pair: return "naked pair";
+    case Technique::x_wing: return "x-wing";
+    case Technique::hidden_pair: return "hidden pair";
+    case Technique::naked_triple: return "naked triple";
+    case Technique::swordfish: return "swordfish";
+    case Technique::hidden_triple: return "hidden triple";
+    case Technique::search: return "search";
+    }
+    return "";
+}
+
+template <int Box>
+int BasicLogicSolver<Box>::rating(Technique technique)
+{
+    static const int ratings[technique_count] = {
+        15, 23, 28, 30, 32, 34, 36, 38, 40, 100
+    };
+    return ratings[static_cast<int>(technique)];
+}
+
+template <int Box>
+std::string BasicLogicSolver<Box>::describe(const Step& step)
+{
+    std::ostringstream ss;
+    ss << name(step.technique) << ": ";
+    if (step.cell >= 0) {
+        ss << 'r' << step.cell / size + 1 << 'c' << step.cell % size + 1
+           << " = " << step.entry;
+    } else if (step.technique == Technique::search) {
+        ss << step.count << " nodes";
+    } else {
+        ss << step.count << " candidate" << (step.count == 1 ? "" : "s");
+        if (step.entry != 0) ss << " of " << step.entry;
+        ss << " removed";
+    }
+
+    if (step.unit >= 0) {
+        const char* kinds[] = { " in row ", " in column ", " in square " };
+        ss << kinds[step.unit / size] << step.unit % size + 1;
+    }
+    return ss.str();
+}
+
+template <int Box>
+void BasicLogicSolver<Box>::place(int cell, int entry)
+{
+    const Mask bit = 1u << (entry - 1);
+    m_cells[cell] = entry;
+    m_candidates[cell] = 0;
+    m_empty--;
+    for (int unit : geometry<Box>.units_of[cell]) {
+        m_placed[unit] |= bit;
+    }
+    for (int peer : geometry<Box>.peers[cell]) {
+        m_candidates[peer] &= ~bit;
+    }
+}
+
+template <int Box>
+void BasicLogicSolver<Box>::remove(int cell, Mask entries,
+                                   unsigned long int& count)
+{
+    Mask removed = m_candidates[cell] & entries;
+    if (!removed) return;
+    m_candidates[cell] &= ~removed;
+    count += bit_count(removed);
+}
+
+template <int Box>
+void BasicLogicSolver<Box>::step(Technique technique, int cell, int entry,
+                                 int unit, unsigned long int count)
+{
+    m_uses[static_cast<int>(technique)]++;
+    if (rating(technique) > m_difficulty) {
+        m_difficulty = rating(technique);
+        m_hardest = technique;
+    }
+    if (m_trace) {
+        m_steps.push_back(Step{ technique, cell, entry, unit, count });
+    }
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::hidden_singles()
+{
+    bool progress = false;
+    for (int unit = 0; unit < units; ++unit) {
+        const auto& unit_cells = geometry<Box>.unit_cells[unit];
+        Mask once = 0, twice = 0;
+        for (int cell : unit_cells) {
+            twice |= once & m_candidates[cell];
+            once |= m_candidates[cell];
+        }
+        if ((once | m_placed[unit]) != all_entries) {
+            m_contradiction = true;
+            return false;
+        }
+
+        // Earlier placements in the same sweep may have taken a single's
+        // cell, which the naked singles then find empty
+        for (Mask singles = once & ~twice; singles; singles &= singles - 1) {
+            int entry = lowest_bit(singles) + 1;
+            for (int cell : unit_cells) {
+                if (!(m_candidates[cell] & (1u << (entry - 1)))) continue;
+                place(cell, entry);
+                step(Technique::hidden_single, cell, entry, unit, 0);
+                progress = true;
+                break;
+            }
+        }
+    }
+    return progress;
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::naked_singles()
+{
+    bool progress = false;
+    for (int cell = 0; cell < cells; ++cell) {
+        if (m_cells[cell] != 0) continue;
+
+        Mask candidates = m_candidates[cell];
+        if (candidates == 0) {
+            m_contradiction = true;
+            return false;
+        }
+        if (candidates & (candidates - 1)) continue;
+
+        int entry = lowest_bit(candidates) + 1;
+        place(cell, entry);
+        step(Technique::naked_single, cell, entry, -1, 0);
+        progress = true;
+    }
+    return progress;
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::locked_candidates()
+{
+    // Pointing: a number confined to one row or column of a square can't go
+    // anywhere else in that row or column
+    for (int box = 0; box < size; ++box) {
+        const int unit = 2 * size + box;
+        const auto& box_cells = geometry<Box>.unit_cells[unit];
+        for (Mask left = all_entries & ~m_placed[unit]; left;
+                left &= left - 1) {
+            const Mask bit = 1u << lowest_bit(left);
+            Mask rows = 0, cols = 0;
+            for (int cell : box_cells) {
+                if (!(m_candidates[cell] & bit)) continue;
+                rows |= 1u << (cell / size);
+                cols |= 1u << (cell % size);
+            }
+
+            unsigned long int count = 0;
+            if (rows && !(rows & (rows - 1))) {
+                int row = lowest_bit(rows);
+                for (int col = 0; col < size; ++col) {
+                    int cell = row * size + col;
+                    if (box_of<Box>(cell) != box) remove(cell, bit, count);
+                }
+            }
+            if (cols && !(cols & (cols - 1))) {
+                int col = lowest_bit(cols);
+                for (int row = 0; row < size; ++row) {
+                    int cell = row * size + col;
+                    if (box_of<Box>(cell) != box) remove(cell, bit, count);
+                }
+            }
+            if (count > 0) {
+                step(Technique::locked_candidates, -1, lowest_bit(bit) + 1,
+                     unit, count);
+                return true;
+            }
+        }
+    }
+
+    // Claiming: a number confined to one square of a row or column can't go
+    // anywhere else in that square
+    for (int unit = 0; unit < 2 * size; ++unit) {
+        const auto& line_cells = geometry<Box>.unit_cells[unit];
+        for (Mask left = all_entries & ~m_placed[unit]; left;
+                left &= left - 1) {
+            const Mask bit = 1u << lowest_bit(left);
+            Mask boxes = 0;
+            for (int cell : line_cells) {
+                if (m_candidates[cell] & bit) boxes |= 1u << box_of<Box>(cell);
+            }
+            if (!boxes || (boxes & (boxes - 1))) continue;
+
+            unsigned long int count = 0;
+            const int box = lowest_bit(boxes);
+            for (int cell : geometry<Box>.unit_cells[2 * size + box]) {
+                bool in_line = (unit < size ? cell / size == unit :
+                                              cell % size == unit - size);
+                if (!in_line) remove(cell, bit, count);
+            }
+            if (count > 0) {
+                step(Technique::locked_candidates, -1, lowest_bit(bit) + 1,
+                     unit, count);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::naked_subset(int k)
+{
+    const Technique technique = (k == 2 ? Technique::naked_pair :
+                                          Technique::naked_triple);
+    for (int unit = 0; unit < units; ++unit) {
+        const auto& unit_cells = geometry<Box>.unit_cells[unit];
+
+        // Positions in the unit of the cells small enough to take part
+        int positions[size];
+        int n = 0;
+        for (int i = 0; i < size; ++i) {
+            int count = bit_count(m_candidates[unit_cells[i]]);
+            if (count >= 2 && count <= k) positions[n++] = i;
+        }
+
+        // k cells holding only k numbers between them take those numbers
+        // from every other cell of the unit
+        auto apply = [&](Mask members, Mask entries) {
+            unsigned long int count = 0;
+            for (int i = 0; i < size; ++i) {
+                if (!(members & (1u << i))) remove(unit_cells[i], entries,
+                                                   count);
+            }
+            if (count > 0) step(technique, -1, 0, unit, count);
+            return count > 0;
+        };
+
+        for (int a = 0; a < n; ++a) {
+            const Mask ca = m_candidates[unit_cells[positions[a]]];
+            for (int b = a + 1; b < n; ++b) {
+                const Mask cb = ca | m_candidates[unit_cells[positions[b]]];
+                const Mask ab = (1u << positions[a]) | (1u << positions[b]);
+                if (k == 2) {
+                    if (bit_count(cb) == 2 && apply(ab, cb)) return true;
+                    continue;
+                }
+                if (bit_count(cb) > 3) continue;
+                for (int c = b + 1; c < n; ++c) {
+                    const Mask cc = cb |
+                        m_candidates[unit_cells[positions[c]]];
+                    if (bit_count(cc) == 3 &&
+                            apply(ab | (1u << positions[c]), cc)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::hidden_subset(int k)
+{
+    const Technique technique = (k == 2 ? Technique::hidden_pair :
+                                          Technique::hidden_triple);
+    for (int unit = 0; unit < units; ++unit) {
+        const auto& unit_cells = geometry<Box>.unit_cells[unit];
+
+        // Positions in the unit of each number, for the numbers with few
+        // enough places left to take part
+        Mask places[size] = {};
+        for (int i = 0; i < size; ++i) {
+            for (Mask c = m_candidates[unit_cells[i]]; c; c &= c - 1) {
+                places[lowest_bit(c)] |= 1u << i;
+            }
+        }
+        int entries[size];
+        int n = 0;
+        for (int e = 0; e < size; ++e) {
+            int count = bit_count(places[e]);
+            if (count >= 2 && count <= k) entries[n++] = e;
+        }
+
+        // k numbers confined to k cells leave no room there for others
+        auto apply = [&](Mask members, Mask keep) {
+            unsigned long int count = 0;
+            for (int i = 0; i < size; ++i) {
+                if (members & (1u << i)) remove(unit_cells[i], ~keep, count);
+            }
+            if (count > 0) step(technique, -1, 0, unit, count);
+            return count > 0;
+        };
+
+        for (int a = 0; a < n; ++a) {
+            const Mask pa = places[entries[a]];
+            for (int b = a + 1; b < n; ++b) {
+                const Mask pb = pa | places[entries[b]];
+                const Mask ab = (1u << entries[a]) | (1u << entries[b]);
+                if (k == 2) {
+                    if (bit_count(pb) == 2 && apply(pb, ab)) return true;
+                    continue;
+                }
+                if (bit_count(pb) > 3) continue;
+                for (int c = b + 1; c < n; ++c) {
+                    const Mask pc = pb | places[entries[c]];
+                    if (bit_count(pc) == 3 &&
+                            apply(pc, ab | (1u << entries[c]))) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+template <int Box>
+bool BasicLogicSolver<Box>::fish(int k)
+{
+    const Technique technique = (k == 2 ? Technique::x_wing :
+                                          Technique::swordfish);
+    for (int entry = 1; entry <= size; ++entry) {
+        const Mask bit = 1u << (entry - 1);
+
+        // Rows as base lines and columns as cover lines, then the other way
+        // round
+        for (int by_cols = 0; by_cols < 2; ++by_cols) {
+            auto cell_at = [by_cols](int base, int cover) {
+                return by_cols ? cover * size + base : base * size + cover;
+            };
+
+            Mask covers[size];
+            int lines[size];
+            int n = 0;
+            for (int base = 0; base < size; ++base) {
+                covers[base] = 0;
+                for (int cover = 0; cover < size; ++cover) {
+                    if (m_candidates[cell_at(base, cover)] & bit) {
+                        covers[base] |= 1u << cover;
+                    }
+                }
+                int count = bit_count(covers[base]);
+                if (count >= 2 && count <= k) lines[n++] = base;
+            }
+
+            // When the number's places in k base lines all fall in k cover
+            // lines, the rest of those cover lines can't hold it
+            auto apply = [&](Mask bases, Mask cover_lines) {
+                unsigned long int count = 0;
+                for (int base = 0; base < size; ++base) {
+                    if (bases & (1u << base)) continue;
+                    for (Mask c = cover_lines; c; c &= c - 1) {
+                        remove(cell_at(base, lowest_bit(c)), bit, count);
+                    }
+                }
+                if (count > 0) step(technique, -1, entry, -1, count);
+                return count > 0;
+            };
+
+            for (int a = 0; a < n; ++a) {
+                for (int b = a + 1; b < n; ++b) {
+                    const Mask cb = covers[lines[a]] | covers[lines[b]];
+                    const Mask ab = (1u << lines[a]) | (1u << lines[b]);
+                    if (k == 2) {
+                        if (bit_count(cb) == 2 && apply(ab, cb)) return true;
+                        continue;
+                    }
+                    if (bit_count(cb) > 3) continue;
+                    for (int c = b + 1; c < n; ++c) {
+                        const Mask cc = cb | covers[lines[c]];
+                        if (bit_count(cc) == 3 &&
+                                apply(ab | (1u << lines[c]), cc)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+template <int Box>
+void BasicLogicSolver<Box>::search()
+{
+    BasicBoard<Box> b = board();
+    b.set_heuristic(BoardBase::Heuristic::fewest_candidates);
+    unsigned long int found = b.count_solutions(1);
+    step(Technique::search, -1, 0, -1, b.nodes());
+    if (found == 0) {
+        m_result = Result::unsolvable;
+        return;
+    }
+
+    for (int cell = 0; cell < cells; ++cell) {
+        m_cells[cell] = b[cell / size][cell % size];
+        m_candidates[cell] = 0;
+    }
+    m_empty = 0;
+    m_result = Result::searched;
+}
+
+template class BasicLogicSolver<2>;
+template class BasicLogicSolver<3>;
+template class BasicLogicSolver<4>;
+template class BasicLogicSolver<5>;
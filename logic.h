@@ -0,0 +1,151 @@
+#ifndef LOGIC_H
+#define LOGIC_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "sudoku.h"
+
+/*
+ * Solves puzzles the way a person would, keeping the candidates of every
+ * cell and applying named techniques from the cheapest up: singles, locked
+ * candidates, naked and hidden pairs and triples, X-wings and swordfish.
+ * After every step that makes progress it starts again from the cheapest.
+ * Only when every technique stalls does it fall back to search, finishing
+ * the puzzle with BasicBoard.
+ *
+ * A puzzle's difficulty is the rating of the hardest technique it needed,
+ * in tenths on roughly the scale of Sudoku Explainer, so that puzzles
+ * solved with singles alone rate lowest and puzzles that need search rate
+ * above everything else. Unlike BasicBoard::count() it doesn't depend on
+ * the order of the cells. One solver can rate many puzzles in turn; solvers
+ * share nothing, so one per thread can run concurrently.
+ */
+
+template <int Box>
+class BasicLogicSolver {
+public:
+    static constexpr int size = Box * Box;
+    static constexpr int cells = size * size;
+    static constexpr int units = 3 * size;
+
+    // In the order they are tried
+    enum class Technique {
+        hidden_single,
+        naked_single,
+        locked_candidates,
+        naked_pair,
+        x_wing,
+        hidden_pair,
+        naked_triple,
+        swordfish,
+        hidden_triple,
+        search
+    };
+    static constexpr int technique_count = 10;
+
+    enum class Result {
+        // Solved with techniques alone
+        solved,
+        // Solved, but needed search once the techniques stalled
+        searched,
+        // Has no solution
+        unsolvable
+    };
+
+    struct Step {
+        Technique technique;
+        // Cell placed (as row*size+col) for singles, otherwise -1
+        int cell;
+        // Number placed for singles, or removed for locked candidates and
+        // fish, otherwise 0
+        int entry;
+        // Unit the step works in (as numbered in geometry.h), or -1 for
+        // fish and search
+        int unit;
+        // Candidates removed, or for search the nodes visited
+        unsigned long int count;
+    };
+
+    BasicLogicSolver();
+
+    // Whether solve() records every step, for steps(). Rating alone is
+    // faster without.
+    void set_trace(bool trace) { m_trace = trace; }
+
+    Result solve(const BasicBoard<Box>& puzzle);
+
+    // Outcome of the last solve()
+    Result result() const { return m_result; }
+    // Rating of the hardest technique used, in tenths, or 0 if none were
+    int difficulty() const { return m_difficulty; }
+    Technique hardest() const { return m_hardest; }
+    // Times each technique made progress
+    unsigned long int uses(Technique technique) const
+    {
+        return m_uses[static_cast<int>(technique)];
+    }
+    const std::vector<Step>& steps() const { return m_steps; }
+    // The solution, if there is one, or the grid as far as it got
+    BasicBoard<Box> board() const;
+
+    static const char* name(Technique technique);
+    static int rating(Technique technique);
+    // One line describing a step, such as "hidden single: r3c5 = 7 in
+    // square 2"
+    static std::string describe(const Step& step);
+private:
+    typedef unsigned int Mask;
+    static constexpr Mask all_entries = (1u << size) - 1;
+
+    // Fills a cell, taking its number from the candidates of its peers
+    void place(int cell, int entry);
+    // Removes candidates from a cell, counting how many went
+    void remove(int cell, Mask entries, unsigned long int& count);
+
+    // Records progress by a technique
+    void step(Technique technique, int cell, int entry, int unit,
+              unsigned long int count);
+
+    // Each technique returns true once it has made progress. The singles
+    // set m_contradiction instead when a cell or a number has nowhere to
+    // go.
+    bool hidden_singles();
+    bool naked_singles();
+    bool locked_candidates();
+    bool naked_subset(int k);
+    bool hidden_subset(int k);
+    bool fish(int k);
+    // Finishes the grid by search
+    void search();
+
+    std::array<int, cells> m_cells;
+    std::array<Mask, cells> m_candidates;
+    // Numbers already placed in each unit
+    std::array<Mask, units> m_placed;
+    int m_empty;
+    bool m_contradiction;
+
+    bool m_trace;
+    Result m_result;
+    int m_difficulty;
+    Technique m_hardest;
+    std::array<unsigned long int, technique_count> m_uses;
+    std::vector<Step> m_steps;
+};
+
+template <int Box> constexpr int BasicLogicSolver<Box>::size;
+template <int Box> constexpr int BasicLogicSolver<Box>::cells;
+template <int Box> constexpr int BasicLogicSolver<Box>::units;
+template <int Box> constexpr int BasicLogicSolver<Box>::technique_count;
+
+extern template class BasicLogicSolver<2>;
+extern template class BasicLogicSolver<3>;
+extern template class BasicLogicSolver<4>;
+extern template class BasicLogicSolver<5>;
+
+// Logic solver for the classic 9 by 9 board
+typedef BasicLogicSolver<3> LogicSolver;
+
+#endif // LOGIC_H
@@ -13,40 +13,91 @@
 #include <QMessageBox>
 #include <QMenuBar>
 #include <QLabel>
+#include <QActionGroup>
+#include <QFileInfo>
+#include <QListWidget>
 
 #include <QGraphicsView>
 #include <QGraphicsScene>
-#include <QGraphicsTextItem>
-#include <QPen>
 
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <random>
 
 #include "mainwindow.h"
-#include "sudoku.h"
+#include "any_board.h"
 
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
+constexpr int Checker::budget_milliseconds;
+
+namespace {
+
+// Number typed into a field, 0 if it is empty, or -1 if it isn't a number
+// from 1 to size
+int parse_entry(const QString& text, int size)
+{
+    std::string input = text.toStdString();
+
+    if (input.empty()) return 0;
+    if (input.length() > 2 ||
+            !std::all_of(input.begin(), input.end(), ::isdigit)) {
+        return -1;
+    }
+
+    int entry = std::stoi(input);
+    return entry <= size ? entry : -1;
+}
+
+// A duration in whole microseconds, for labels
+QString format_time(SolveStats::Clock::duration duration)
 {
-    this->resize(580, 380);
-    this->setMinimumSize(580, 380);
+    return QString::number(microseconds(duration), 'f', 0) + " " +
+           QChar(0x00b5) + "s";
+}
 
+} // namespace
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent), m_box(3), m_in_board(3), m_out_board(3),
+      m_live(3), m_backend(AnyBoard::Backend::backtracking),
+      m_heuristic(AnyBoard::Heuristic::fewest_candidates), m_shown_job(0),
+      m_source("typed puzzle"), m_puzzle_request(0),
+      m_puzzle_wanted(false), m_size(240)
+{
     create_menus();
     create_output_view();
     create_buttons();
     create_input_array();
     create_labels();
+    layout_widgets();
 
     create_shortcuts();
 
-    m_solver_thread = new QThread(this);
-    m_solver = new Solver();
-    m_solver->moveToThread(m_solver_thread);
+    m_solves = new SolveService(this);
+    connect(m_solves, SIGNAL(finished(int)),
+            this, SLOT(handle_finish_solve(int)), Qt::QueuedConnection);
+
+    m_checker_thread = new QThread(this);
+    m_checker = new Checker();
+    m_checker->moveToThread(m_checker_thread);
+
+    connect(this, SIGNAL(check()), m_checker, SLOT(check()));
+    connect(m_checker, SIGNAL(finished()),
+            this, SLOT(handle_finish_check()));
+    m_checker_thread->start();
 
-    connect(this, SIGNAL(solve()), m_solver, SLOT(solve()));
-    connect(m_solver, SIGNAL(finished()), this, SLOT(handle_finish_solve()));
-    m_solver_thread->start();
+    m_maker_thread = new QThread(this);
+    m_maker = new PuzzleMaker();
+    m_maker->moveToThread(m_maker_thread);
+
+    connect(this, SIGNAL(make()), m_maker, SLOT(make()));
+    connect(m_maker, SIGNAL(finished()),
+            this, SLOT(handle_finish_generate()));
+    m_maker_thread->start();
+
+    reload_live();
 }
 
 MainWindow::~MainWindow()
@@ -76,10 +127,21 @@ MainWindow::~MainWindow()
     delete save_shortcut;
     */
 
-    // Thread clean up
-    m_solver_thread->quit();
-    m_solver->deleteLater();
-    m_solver_thread->deleteLater();
+    // Thread clean up. Jobs still running are cancelled, and the service
+    // waits for them as it goes.
+    m_solves->cancel_all();
+
+    m_checker->cancel();
+    m_checker_thread->quit();
+    m_checker_thread->wait();
+    delete m_checker;
+
+    // A puzzle being made is finished first, as generation can't be
+    // cancelled
+    m_maker->cancel();
+    m_maker_thread->quit();
+    m_maker_thread->wait();
+    delete m_maker;
 }
 
 // ----------------------------------------------------------------------------
@@ -92,31 +154,39 @@ void MainWindow::handle_open()
 
     std::ifstream file(file_name.toStdString());
 
-    Board test_board;
-    if (!(file >> test_board)) {
+    // Files are read as boards of the size currently selected
+    AnyBoard test_board(m_box);
+    if (!test_board.read(file)) {
         alert("Error reading file");
     } else {
         handle_clear();
+        m_puzzle_wanted = false;
 
         m_in_board = test_board;
-        for (std::size_t row = 0; row < 9; ++row) {
-            for (std::size_t col = 0; col < 9; ++col) {
-                int num = m_in_board[row][col];
-                std::string text = std::to_string(num);
-                if (text == "0") text = "";
-                input_array[row][col]->setText(text.c_str());
-            }
-        }
+        m_source = QFileInfo(file_name).fileName();
+        print_input();
     }
 }
 
-void MainWindow::handle_solve()
+void MainWindow::handle_new_puzzle()
 {
-    // If the thread is busy, don't do anything for now
-    if (m_solver->solving()) {
-        return;
-    }
+    // Proving a sparse 16 by 16 or 25 by 25 puzzle unique can take a long
+    // search, so the puzzle is made on the maker's thread, and there the
+    // generator gives up on a clue early and keeps it
+    ++m_puzzle_request;
+    m_puzzle_wanted = true;
+    m_maker->request(m_box, std::random_device()(), m_box > 3 ? 100 : 0,
+                     m_puzzle_request);
+    emit make();
+
+    new_puzzle_action->setEnabled(false);
+    new_puzzle_shortcut->setEnabled(false);
+    status_label->setText(status_label->property("display_text").toString() +
+                          "generating a new one...");
+}
 
+void MainWindow::handle_solve()
+{
     if (!update_board()) {
         alert("Bad input");
         return;
@@ -127,9 +197,11 @@ void MainWindow::handle_solve()
         return;
     }
 
-    m_solver->set_board(m_in_board);
-    emit solve();
+    m_in_board.set_backend(m_backend);
+    m_in_board.set_heuristic(m_heuristic);
+    m_shown_job = m_solves->submit(m_in_board, m_source);
     print_waiting();
+    print_jobs();
 }
 
 void MainWindow::handle_save()
@@ -148,22 +220,22 @@ void MainWindow::handle_save()
 
 void MainWindow::handle_clear()
 {
-    if (m_solver->solving()) {
-        m_solver->cancel();
-    }
+    m_solves->cancel(m_shown_job);
+    m_shown_job = 0;
+    m_source = "typed puzzle";
 
     m_in_board.clear();
     m_out_board.clear();
 
     clear_output();
-    print_grid();
 
     // Clear input
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
-            input_array[row][col]->setText("");
+    for (auto& row : input_array) {
+        for (QLineEdit* input : row) {
+            input->setText("");
         }
     }
+    reload_live();
 }
 
 void MainWindow::handle_copy_input_board()
@@ -176,27 +248,119 @@ void MainWindow::handle_copy_output_board()
     copy_board(false);
 }
 
-void MainWindow::handle_finish_solve()
+void MainWindow::handle_solver_mode()
 {
-    if (!(m_solver->cancelled())) {
-        m_out_board = m_solver->board();
+    if (dancing_links_action->isChecked()) {
+        m_backend = AnyBoard::Backend::dancing_links;
+        return;
+    }
 
-        if (!m_solver->solvable()) {
-            clear_output();
-            alert("Unsolvable");
-        } else {
-            print_output(m_solver->milliseconds());
-        }
+    m_backend = AnyBoard::Backend::backtracking;
+    if (first_empty_action->isChecked()) {
+        m_heuristic = AnyBoard::Heuristic::first_empty;
+    } else {
+        m_heuristic = AnyBoard::Heuristic::fewest_candidates;
     }
 }
 
+void MainWindow::handle_size()
+{
+    int box = size_group->checkedAction()->data().toInt();
+    if (box == m_box) return;
+
+    m_solves->cancel(m_shown_job);
+    m_shown_job = 0;
+
+    m_box = box;
+    m_puzzle_wanted = false;
+    m_in_board = AnyBoard(m_box);
+    m_out_board = AnyBoard(m_box);
+
+    create_input_array();
+    layout_widgets();
+    clear_output();
+    reload_live();
+}
+
+void MainWindow::handle_edit()
+{
+    QLineEdit* input = qobject_cast<QLineEdit*>(sender());
+    if (!input) return;
+
+    // Only the field's own units change, so this stays well inside a frame
+    // even on a 25 by 25 board
+    int row = input->property("row").toInt();
+    int col = input->property("col").toInt();
+    m_live.set(row, col, parse_entry(input->text(), m_live.size()));
+    print_live_peers(row, col);
+    request_check();
+}
+
+void MainWindow::handle_finish_solve(int id)
+{
+    print_jobs();
+    if (id == m_shown_job) {
+        show_job(id);
+    }
+}
+
+void MainWindow::handle_job_activated(QListWidgetItem* item)
+{
+    m_shown_job = item->data(Qt::UserRole).toInt();
+    show_job(m_shown_job);
+}
+
+void MainWindow::handle_finish_generate()
+{
+    unsigned long long int request;
+    AnyBoard puzzle = m_maker->puzzle(request);
+    if (request != m_puzzle_request) return;
+
+    new_puzzle_action->setEnabled(true);
+    new_puzzle_shortcut->setEnabled(true);
+    if (!m_puzzle_wanted) return;
+    m_puzzle_wanted = false;
+
+    handle_clear();
+    m_in_board = puzzle;
+    m_source = "generated puzzle";
+    print_input();
+}
+
+void MainWindow::handle_finish_check()
+{
+    unsigned long long int revision;
+    Checker::Outcome outcome = m_checker->outcome(revision);
+
+    // A check of a grid since typed over says nothing about this one
+    if (revision != m_live.revision()) return;
+
+    QString text = status_label->property("display_text").toString();
+    switch (outcome) {
+    case Checker::Outcome::unique:
+        text += "unique solution";
+        break;
+    case Checker::Outcome::multiple:
+        text += "several solutions";
+        break;
+    case Checker::Outcome::unsolvable:
+        text += "no solution";
+        break;
+    case Checker::Outcome::unknown:
+        text += "not decided yet, press Solve";
+        break;
+    }
+    status_label->setText(text);
+}
+
 // ----------------------------------------------------------------------------
 
 bool MainWindow::eventFilter(QObject* obj, QEvent* event)
 {
     if (obj->property("input") == true) {
-        std::size_t row = obj->property("row").toInt();
-        std::size_t col = obj->property("col").toInt();
+        const int size = m_box * m_box;
+        int row = obj->property("row").toInt();
+        int col = obj->property("col").toInt();
 
         if (event->type() == QEvent::FocusIn) {
             input_array[row][col]->selectAll();
@@ -205,19 +369,19 @@ bool MainWindow::eventFilter(QObject* obj, QEvent* event)
             QKeyEvent* key_event = static_cast<QKeyEvent*>(event);
 
             if (key_event->key() == Qt::Key_Up) {
-                if (row == 0) row = 9;
+                if (row == 0) row = size;
                 input_array[row-1][col]->setFocus();
                 return true;
             } else if (key_event->key() == Qt::Key_Down) {
-                if (row == 8) row = -1;
+                if (row == size - 1) row = -1;
                 input_array[row+1][col]->setFocus();
                 return true;
             } else if (key_event->key() == Qt::Key_Left) {
-                if (col == 0) col = 9;
+                if (col == 0) col = size;
                 input_array[row][col-1]->setFocus();
                 return true;
             } else if (key_event->key() == Qt::Key_Right) {
-                if (col == 8) col = -1;
+                if (col == size - 1) col = -1;
                 input_array[row][col+1]->setFocus();
                 return true;
             }
@@ -233,92 +397,176 @@ bool MainWindow::update_board()
 {
     m_in_board.clear();
 
-    std::array<std::array<int, 9>, 9> grid;
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
-            std::string input = input_array[row][col]->text().toStdString();
-
-            if (input.empty()) input = "0";
-            if (input.length() > 1 || !std::isdigit(input[0])) {
-                return false;
-            }
+    // The live grid has already parsed every field
+    if (m_live.bad_inputs() > 0) {
+        return false;
+    }
 
-            int num_input = std::stoi(input);
-            grid[row][col] = num_input;
+    AnyBoard board(m_box);
+    for (int row = 0; row < board.size(); ++row) {
+        for (int col = 0; col < board.size(); ++col) {
+            board.set(row, col, m_live.at(row, col));
         }
     }
 
-    m_in_board = Board(grid);
+    m_in_board = board;
     return true;
 }
 
-void MainWindow::print_output(unsigned long int milliseconds)
+void MainWindow::print_input()
 {
-    clear_output();
-    print_grid();
+    for (int row = 0; row < m_in_board.size(); ++row) {
+        for (int col = 0; col < m_in_board.size(); ++col) {
+            int num = m_in_board.at(row, col);
+            std::string text = std::to_string(num);
+            if (text == "0") text = "";
+            input_array[row][col]->setText(text.c_str());
+        }
+    }
+    reload_live();
+}
+
+void MainWindow::show_job(int id)
+{
+    SolveService::Status status;
+    AnyBoard puzzle, solution;
+    if (!m_solves->result(id, status, puzzle, solution)) {
+        // Cancelled, superseded, or not finished yet
+        return;
+    }
+    if (puzzle.box() != m_box) {
+        clear_output();
+        alert("That puzzle is of another size");
+        return;
+    }
+
+    m_out_board = solution;
+    if (status.result == AnyBoard::Result::budget_exceeded) {
+        clear_output();
+        alert("Gave up before finding a solution");
+    } else if (status.solutions == 0) {
+        clear_output();
+        solutions_label->setText(
+            solutions_label->property("display_text").toString() + "none");
+        alert("Unsolvable");
+    } else {
+        print_output(puzzle, status);
+    }
+}
+
+void MainWindow::print_output(const AnyBoard& puzzle,
+                              const SolveService::Status& status)
+{
+    // Only the cells that differ from what is shown get repainted
+    clear_labels();
+    output_board->set_message(QString());
 
+    // Puzzles answered from the solution cache weren't searched at all
+    const SolveStats& stats = status.stats;
     QString timer_text = timer_label->property("display_text").toString() +
-                         QString::number(milliseconds) + " ms";
+                         format_time(status.elapsed);
+    QString count_text = count_label->property("display_text").toString();
+    if (status.cached) {
+        count_text += "none, from cache";
+    } else {
+        timer_text += " (search " + format_time(stats.search_time) + ")";
+        count_text += QString("%1 / %2 / %3").arg(stats.nodes)
+                      .arg(stats.backtracks).arg(stats.max_depth);
+    }
     timer_label->setText(timer_text);
-
-    QString count_text = count_label->property("display_text").toString() +
-                         QString::number(m_out_board.count());
     count_label->setText(count_text);
 
-    // Print the numbers in the grid
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
-            bool original = (m_in_board[row][col] == m_out_board[row][col]);
-
-            QString output = QString::number(m_out_board[row][col]);
-            QGraphicsTextItem* text_item = output_scene->addText(output);
+    timer_label->setToolTip(
+        QString("Checking the givens: %1\nSearching: %2\n"
+                "Whole job, with the cache lookup: %3")
+        .arg(format_time(stats.validate_time))
+        .arg(format_time(stats.search_time))
+        .arg(format_time(status.elapsed)));
+
+    const SolutionCache& cache = m_solves->cache();
+    count_label->setToolTip(
+        QString("Numbers tried: %1\nPlaced by propagation: %2\n"
+                "Solution cache: %3% hit rate, %4 puzzles, %5 KiB")
+        .arg(status.cached ? 0 : m_out_board.count())
+        .arg(stats.propagations)
+        .arg(cache.hit_rate() * 100, 0, 'f', 1)
+        .arg(cache.size())
+        .arg(cache.memory() / 1024));
+
+    QString solutions_text =
+        solutions_label->property("display_text").toString() +
+        (status.solutions > 1 ? "multiple" : "unique");
+    solutions_label->setText(solutions_text);
+
+    // Print the numbers in the grid, the ones given in the puzzle in red
+    const int size = m_out_board.size();
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            bool original = (puzzle.at(row, col) ==
+                             m_out_board.at(row, col));
+            output_board->set_cell(row, col, m_out_board.at(row, col),
+                                   original);
+        }
+    }
+}
 
-            if (original) {
-                output = "<font color=\"red\"><b>" + output + "</b></font>";
-                text_item->setHtml(output);
+void MainWindow::print_jobs()
+{
+    job_list->clear();
+    for (const SolveService::Status& status : m_solves->jobs()) {
+        QString text = QString("%1. %2: ").arg(status.id).arg(status.source);
+        switch (status.state) {
+        case SolveService::State::queued:
+            text += "queued";
+            break;
+        case SolveService::State::running:
+            text += "solving...";
+            break;
+        case SolveService::State::finished:
+            if (status.result == AnyBoard::Result::budget_exceeded) {
+                text += "gave up";
+            } else if (status.solutions == 0) {
+                text += "unsolvable";
+            } else {
+                text += (status.solutions > 1 ? "multiple" : "unique");
             }
+            text += ", " + format_time(status.elapsed);
+            break;
+        case SolveService::State::cancelled:
+            text += "cancelled";
+            break;
+        case SolveService::State::superseded:
+            text += "superseded";
+            break;
+        }
 
-            QFont font;
-            font.setPixelSize(m_size*0.7/9);
-            text_item->setFont(font);
-
-            text_item->setPos(m_size*col/9, m_size*0.98*row/9);
+        QListWidgetItem* item = new QListWidgetItem(text, job_list);
+        item->setData(Qt::UserRole, status.id);
+        if (status.id == m_shown_job) {
+            job_list->setCurrentItem(item);
         }
     }
+    job_list->scrollToBottom();
 }
 
 void MainWindow::print_waiting()
 {
     clear_output();
-    QGraphicsTextItem* text_item = output_scene->addText("Waiting...");
-    text_item->setPos(0.8 * m_size / 2, m_size / 2);
+    output_board->set_message("Waiting...");
 }
 
-void MainWindow::print_grid()
+void MainWindow::clear_output()
 {
-    QPen pen = QPen();
-    pen.setWidth(m_big_width);
-
-    output_scene->addRect(QRectF(0, 0, m_size, m_size), pen);
-
-    for (int i = 1; i < 9; ++i) {
-        if (i % 3 == 0) pen.setWidth(m_big_width);
-        else pen.setWidth(m_small_width);
-
-        output_scene->addLine(QLineF(m_size*i/9, 0, m_size*i/9, m_size), pen);
-        output_scene->addLine(QLineF(0, m_size*i/9, m_size, m_size*i/9), pen);
-    }
+    clear_labels();
+    output_board->clear();
 }
 
-void MainWindow::clear_output()
+void MainWindow::clear_labels()
 {
     timer_label->setText(timer_label->property("display_text").toString());
     count_label->setText(count_label->property("display_text").toString());
-
-    for (auto i : output_scene->items()) {
-        output_scene->removeItem(i);
-        delete i;
-    }
+    solutions_label->setText(
+        solutions_label->property("display_text").toString());
 }
 
 void MainWindow::alert(const std::string& message)
@@ -328,6 +576,103 @@ void MainWindow::alert(const std::string& message)
     message_box.exec();
 }
 
+void MainWindow::reload_live()
+{
+    m_live.reset(m_box);
+    for (int row = 0; row < m_live.size(); ++row) {
+        for (int col = 0; col < m_live.size(); ++col) {
+            m_live.set(row, col, parse_entry(input_array[row][col]->text(),
+                                             m_live.size()));
+        }
+    }
+
+    for (int row = 0; row < m_live.size(); ++row) {
+        for (int col = 0; col < m_live.size(); ++col) {
+            print_live_cell(row, col);
+        }
+    }
+    request_check();
+}
+
+void MainWindow::print_live_cell(int row, int col)
+{
+    QLineEdit* input = input_array[row][col];
+
+    // Clashing numbers and bad input in red, and unfilled cells left with
+    // no candidates shaded
+    LiveGrid::Mask candidates = m_live.candidates(row, col);
+    QString style;
+    if (m_live.conflicted(row, col) || m_live.bad(row, col)) {
+        style = "color: red; font-weight: bold";
+    } else if (m_live.at(row, col) == 0 && candidates == 0) {
+        style = "background: #f4c7c3";
+    }
+    // Restyling is the slowest part of an edit, so skip it when it can
+    if (input->styleSheet() != style) {
+        input->setStyleSheet(style);
+    }
+
+    QString tip;
+    if (m_live.at(row, col) == 0 && !m_live.bad(row, col)) {
+        tip = "Candidates:";
+        for (int entry = 1; entry <= m_live.size(); ++entry) {
+            if (candidates & (LiveGrid::Mask(1) << (entry - 1))) {
+                tip += " " + QString::number(entry);
+            }
+        }
+        if (candidates == 0) tip += " none";
+    }
+    input->setToolTip(tip);
+}
+
+void MainWindow::print_live_peers(int row, int col)
+{
+    const int size = m_live.size();
+    const int box_row = row / m_box * m_box;
+    const int box_col = col / m_box * m_box;
+    for (int i = 0; i < size; ++i) {
+        print_live_cell(row, i);
+        print_live_cell(i, col);
+        print_live_cell(box_row + i / m_box, box_col + i % m_box);
+    }
+}
+
+void MainWindow::request_check()
+{
+    // Anything the live grid shows by itself is reported at once, and there
+    // is no point searching such a grid
+    QString text = status_label->property("display_text").toString();
+    if (m_live.bad_inputs() > 0) {
+        status_label->setText(text + "bad input");
+        m_checker->cancel();
+        return;
+    }
+    if (m_live.conflicts() > 0) {
+        status_label->setText(text + QString::number(m_live.conflicts()) +
+                              (m_live.conflicts() > 1 ? " clashes" :
+                                                        " clash"));
+        m_checker->cancel();
+        return;
+    }
+    if (m_live.dead_end()) {
+        status_label->setText(text + "a cell has no candidates");
+        m_checker->cancel();
+        return;
+    }
+
+    AnyBoard board(m_box);
+    for (int row = 0; row < m_live.size(); ++row) {
+        for (int col = 0; col < m_live.size(); ++col) {
+            board.set(row, col, m_live.at(row, col));
+        }
+    }
+    board.set_heuristic(AnyBoard::Heuristic::fewest_candidates);
+
+    status_label->setText(text + "checking...");
+    m_checker->request(board, m_live.revision());
+    emit check();
+}
+
 void MainWindow::copy_board(bool input_board)
 {
     if (!update_board()) {
@@ -336,7 +681,7 @@ void MainWindow::copy_board(bool input_board)
     }
 
     QClipboard* clipboard = QApplication::clipboard();
-    Board& b = (input_board ? m_in_board : m_out_board);
+    AnyBoard& b = (input_board ? m_in_board : m_out_board);
     clipboard->setText(b.str().c_str());
 }
 
@@ -345,15 +690,19 @@ void MainWindow::copy_board(bool input_board)
 void MainWindow::create_menus()
 {
     open_action = new QAction(tr("&Open a sudoku file"), this);
+    new_puzzle_action = new QAction(tr("&New puzzle"), this);
     save_action = new QAction(tr("&Save this puzzle"), this);
     close_action = new QAction(tr("&Exit"), this);
 
     file_menu = menuBar()->addMenu(tr("&File"));
+    file_menu->addAction(new_puzzle_action);
     file_menu->addAction(open_action);
     file_menu->addAction(save_action);
     file_menu->addAction(close_action);
 
     connect(open_action, SIGNAL(triggered()), this, SLOT(handle_open()));
+    connect(new_puzzle_action, SIGNAL(triggered()),
+            this, SLOT(handle_new_puzzle()));
     connect(close_action, SIGNAL(triggered()), this, SLOT(close()));
     connect(save_action, SIGNAL(triggered()), this, SLOT(handle_save()));
 
@@ -374,17 +723,67 @@ void MainWindow::create_menus()
             SIGNAL(triggered()),
             this,
             SLOT(handle_copy_output_board()));
+
+    first_empty_action = new QAction(tr("Branch on &first empty cell"), this);
+    fewest_candidates_action = new QAction(
+        tr("Branch on fewest &candidates"), this);
+    dancing_links_action = new QAction(tr("&Dancing links"), this);
+    first_empty_action->setCheckable(true);
+    fewest_candidates_action->setCheckable(true);
+    dancing_links_action->setCheckable(true);
+    fewest_candidates_action->setChecked(true);
+
+    QActionGroup* mode_group = new QActionGroup(this);
+    mode_group->addAction(first_empty_action);
+    mode_group->addAction(fewest_candidates_action);
+    mode_group->addAction(dancing_links_action);
+
+    solver_menu = menuBar()->addMenu(tr("S&olver"));
+    solver_menu->addAction(first_empty_action);
+    solver_menu->addAction(fewest_candidates_action);
+    solver_menu->addAction(dancing_links_action);
+
+    connect(first_empty_action, SIGNAL(triggered()),
+            this, SLOT(handle_solver_mode()));
+    connect(fewest_candidates_action, SIGNAL(triggered()),
+            this, SLOT(handle_solver_mode()));
+    connect(dancing_links_action, SIGNAL(triggered()),
+            this, SLOT(handle_solver_mode()));
+
+    size_group = new QActionGroup(this);
+    size_menu = menuBar()->addMenu(tr("Si&ze"));
+    for (int box = 2; box <= 5; ++box) {
+        QString text = QString("&%1 x %1").arg(box * box);
+        QAction* size_action = new QAction(text, this);
+        size_action->setCheckable(true);
+        size_action->setChecked(box == 3);
+        size_action->setData(box);
+
+        size_group->addAction(size_action);
+        size_menu->addAction(size_action);
+        connect(size_action, SIGNAL(triggered()), this, SLOT(handle_size()));
+    }
 }
 
 void MainWindow::create_input_array()
 {
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
+    for (auto& row : input_array) {
+        for (QLineEdit* input : row) {
+            delete input;
+        }
+    }
+
+    // The largest boards get narrower fields, to keep the window on screen
+    const int size = m_box * m_box;
+    const int width = (m_box > 4 ? 20 : 24);
+    input_array.assign(size, std::vector<QLineEdit*>(size, nullptr));
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
             input_array[row][col] = new QLineEdit(this);
 
-            int x = 30 + (col * 26) + 5 * (col / 3);
-            int y = 50 + (row * 26) + 5 * (row / 3);
-            input_array[row][col]->setGeometry(x, y, 24, 24);
+            int x = 30 + (col * (width + 2)) + 5 * (col / m_box);
+            int y = 50 + (row * (width + 2)) + 5 * (row / m_box);
+            input_array[row][col]->setGeometry(x, y, width, width);
 
             input_array[row][col]->setProperty("input", true);
             input_array[row][col]->setProperty("row", (int)row);
@@ -394,8 +793,13 @@ void MainWindow::create_input_array()
                     SIGNAL(returnPressed()),
                     this,
                     SLOT(handle_solve()));
+            connect(input_array[row][col],
+                    SIGNAL(textEdited(QString)),
+                    this,
+                    SLOT(handle_edit()));
 
             input_array[row][col]->installEventFilter(this);
+            input_array[row][col]->show();
         }
     }
 }
@@ -405,22 +809,59 @@ void MainWindow::create_output_view()
     output_scene = new QGraphicsScene();
 
     output_view = new QGraphicsView(output_scene, this);
-    output_view->setGeometry(300, 50, m_size+m_big_width*2, m_size+m_big_width*2);
 
-    print_grid();
+    // Created once, and resized along with the input array
+    output_board = new OutputBoard(m_box, m_size);
+    output_scene->addItem(output_board);
+}
+
+void MainWindow::layout_widgets()
+{
+    // Bottom right corner of the input array
+    QLineEdit* last = input_array.back().back();
+    const int input_width = last->geometry().right() + 1 - 30;
+    const int input_height = last->geometry().bottom() + 1;
+
+    m_size = std::max(240, input_width - 2);
+    const int output_x = 30 + input_width + 28;
+    output_view->setGeometry(output_x, 50, m_size+m_big_width*2,
+                             m_size+m_big_width*2);
+    output_scene->setSceneRect(0, 0, m_size, m_size);
+    output_board->resize(m_box, m_size);
+
+    solve_button->setGeometry(30, input_height + 18, input_width, 20);
+    clear_button->setGeometry(30, input_height + 48, input_width, 20);
+    job_list->setGeometry(30, input_height + 78, input_width, 80);
+
+    const int x_pos = output_x;
+    const int y_pos = output_view->geometry().height() + 50 + 15;
+    const int x_size = output_view->geometry().width();
+    timer_label->setGeometry(x_pos, y_pos, x_size, 20);
+    count_label->setGeometry(x_pos, y_pos + 30, x_size, 20);
+    solutions_label->setGeometry(x_pos, y_pos + 60, x_size, 20);
+    status_label->setGeometry(x_pos, y_pos + 90, x_size, 20);
+
+    const int width = output_x + x_size + 36;
+    const int height = std::max(y_pos + 90, input_height + 158) + 41;
+    this->setMinimumSize(width, height);
+    this->resize(width, height);
 }
 
 void MainWindow::create_buttons()
 {
     solve_button = new QPushButton(this);
     solve_button->setText("Solve");
-    solve_button->setGeometry(30, 310, 242, 20);
     connect(solve_button, SIGNAL(clicked()), this, SLOT(handle_solve()));
 
     clear_button = new QPushButton(this);
     clear_button->setText("Clear");
-    clear_button->setGeometry(30, 340, 242, 20);
     connect(clear_button, SIGNAL(clicked()), this,  SLOT(handle_clear()));
+
+    // Not a button, but it sits with them below the input array
+    job_list = new QListWidget(this);
+    job_list->setToolTip("Solves, newest last. Click one to show it.");
+    connect(job_list, SIGNAL(itemClicked(QListWidgetItem*)),
+            this, SLOT(handle_job_activated(QListWidgetItem*)));
 }
 
 void MainWindow::create_labels()
@@ -430,17 +871,20 @@ void MainWindow::create_labels()
     timer_label->setProperty("display_text" , display_text);
     timer_label->setText(display_text);
 
-    const int x_pos = 300;
-    const int y_pos = output_view->geometry().height() + 50 + 15;
-    const int x_size = output_view->geometry().width();
-    timer_label->setGeometry(x_pos, y_pos, x_size, 20);
-
     count_label = new QLabel(this);
-    display_text = "Number of numbers tried: ";
+    display_text = "Nodes / backtracks / depth: ";
     count_label->setProperty("display_text", display_text);
     count_label->setText(display_text);
 
-    count_label->setGeometry(x_pos, y_pos + 30, x_size, 20);
+    solutions_label = new QLabel(this);
+    display_text = "Solution: ";
+    solutions_label->setProperty("display_text", display_text);
+    solutions_label->setText(display_text);
+
+    status_label = new QLabel(this);
+    display_text = "Puzzle so far: ";
+    status_label->setProperty("display_text", display_text);
+    status_label->setText(display_text);
 }
 
 void MainWindow::create_shortcuts()
@@ -448,6 +892,11 @@ void MainWindow::create_shortcuts()
     open_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_O), this);
     connect(open_shortcut, SIGNAL(activated()), this, SLOT(handle_open()));
 
+    new_puzzle_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_N),
+                                        this);
+    connect(new_puzzle_shortcut, SIGNAL(activated()),
+            this, SLOT(handle_new_puzzle()));
+
     save_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_S), this);
     connect(save_shortcut, SIGNAL(activated()), this, SLOT(handle_save()));
 }
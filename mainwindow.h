@@ -1,8 +1,10 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include <array>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <vector>
 
 #include <QThread>
 #include <QMainWindow>
@@ -13,77 +15,204 @@
 #include <QTextBrowser>
 #include <QShortcut>
 #include <QLabel>
+#include <QListWidget>
 
 #include <QGraphicsView>
 #include <QGraphicsScene>
 
-#include "sudoku.h"
+#include "any_board.h"
+#include "live_grid.h"
+#include "output_board.h"
+#include "solve_service.h"
 
 QT_BEGIN_NAMESPACE
 class QAction;
+class QActionGroup;
 class QMenu;
 QT_END_NAMESPACE
 
-class Solver : public QObject {
+/*
+ * Checks in the background whether the puzzle being typed has a solution,
+ * so that the user hears about it without pressing Solve. Only the latest
+ * request matters: a new one replaces any still queued and cancels the
+ * check running, so fast typing never piles up work. Checks search on one
+ * thread within a time budget, and report unknown once it runs out.
+ */
+
+class Checker : public QObject {
 Q_OBJECT
 public:
-    Solver()
-        : m_board(Board()), m_milliseconds(0),
-          m_solvable(true), m_solving(false), m_cancelled(false)
-    {}
+    enum class Outcome { unique, multiple, unsolvable, unknown };
 
-    Board board() const { return m_board; }
+    // Longest a check searches for
+    static constexpr int budget_milliseconds = 250;
 
-    unsigned long int milliseconds() const { return m_milliseconds; }
+    Checker()
+        : m_board(AnyBoard()), m_pending_board(AnyBoard()),
+          m_pending_revision(0), m_pending(false), m_revision(0),
+          m_outcome(Outcome::unknown)
+    {}
 
-    bool solvable() const { return m_solvable; }
-    bool solving() const { return m_solving; }
-    bool cancelled() const { return m_cancelled; }
+    // Called from the GUI thread. board is checked as the grid of the given
+    // revision, once check() runs.
+    void request(const AnyBoard& board, unsigned long long int revision)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending_board = board;
+        m_pending_revision = revision;
+        m_pending = true;
+        m_board.cancel();
+    }
 
+    // Drops any queued request and cancels the check running
     void cancel()
     {
-        m_cancelled = true;
-        
-        // Cancel the board. This means that any attempt to call
-        // m_board.solve() will simply return without actually solving
-        // anything. Any currently running solve attempt should also exit
-        // immediately.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = false;
         m_board.cancel();
     }
 
-    void set_board(Board board)
+    // Outcome of the last check finished, and the revision it was for
+    Outcome outcome(unsigned long long int& revision) const
     {
-        m_board = board;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        revision = m_revision;
+        return m_outcome;
     }
 public slots:
-    void solve()
+    void check()
     {
-        m_cancelled = false;
-        m_solving = true;
-        m_solvable = true;
-        m_milliseconds = 0;
+        for (;;) {
+            unsigned long long int revision;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_pending) return;
+                m_board = m_pending_board;
+                revision = m_pending_revision;
+                m_pending = false;
+            }
+
+            m_board.set_time_budget(
+                std::chrono::milliseconds(budget_milliseconds));
+            unsigned long int solutions = m_board.count_solutions(2);
 
-        auto begin_time = std::chrono::steady_clock::now();
+            // Cancelled checks were superseded, so there is nothing to say
+            AnyBoard::Result result = m_board.result();
+            if (result == AnyBoard::Result::cancelled) continue;
+
+            Outcome outcome =
+                result == AnyBoard::Result::budget_exceeded ?
+                    Outcome::unknown :
+                solutions == 0 ? Outcome::unsolvable :
+                solutions == 1 ? Outcome::unique : Outcome::multiple;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_revision = revision;
+                m_outcome = outcome;
+            }
+            emit finished();
+        }
+    }
+signals:
+    void finished();
+private:
+    // Guards everything below but the search itself, which runs on m_board
+    // without the lock (cancelling it is safe from any thread)
+    mutable std::mutex m_mutex;
+    AnyBoard m_board;
+    AnyBoard m_pending_board;
+    unsigned long long int m_pending_revision;
+    bool m_pending;
+    unsigned long long int m_revision;
+    Outcome m_outcome;
+};
+
+/*
+ * Generates new puzzles in the background, since proving a sparse 16 by 16
+ * or 25 by 25 puzzle unique can take a long search. Generation can't be
+ * cancelled, so a request made while one runs waits for it, and only the
+ * latest request waiting is carried out.
+ */
+
+class PuzzleMaker : public QObject {
+Q_OBJECT
+public:
+    PuzzleMaker()
+        : m_pending_box(3), m_pending_seed(0), m_pending_budget(0),
+          m_pending_request(0), m_pending(false), m_puzzle(AnyBoard()),
+          m_request(0)
+    {}
 
-        m_solvable = m_board.solve();
+    // Called from the GUI thread. A puzzle of the given box size is made
+    // from seed for the given request, once make() runs, with node_budget
+    // limiting each uniqueness check (see AnyBoard::generate()).
+    void request(int box, unsigned long long int seed,
+                 unsigned long int node_budget,
+                 unsigned long long int request)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending_box = box;
+        m_pending_seed = seed;
+        m_pending_budget = node_budget;
+        m_pending_request = request;
+        m_pending = true;
+    }
 
-        auto end_time = std::chrono::steady_clock::now();
+    // Drops any queued request
+    void cancel()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = false;
+    }
 
-        m_milliseconds =
-            std::chrono::duration_cast<std::chrono::milliseconds>
-            (end_time - begin_time).count();
+    // Last puzzle made, and the request it was for
+    AnyBoard puzzle(unsigned long long int& request) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        request = m_request;
+        return m_puzzle;
+    }
+public slots:
+    void make()
+    {
+        for (;;) {
+            int box;
+            unsigned long long int seed;
+            unsigned long int node_budget;
+            unsigned long long int request;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_pending) return;
+                box = m_pending_box;
+                seed = m_pending_seed;
+                node_budget = m_pending_budget;
+                request = m_pending_request;
+                m_pending = false;
+            }
 
-        m_solving = false;
-        emit finished();
+            AnyBoard puzzle(box);
+            puzzle.generate(seed, node_budget);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_puzzle = puzzle;
+                m_request = request;
+            }
+            emit finished();
+        }
     }
 signals:
     void finished();
 private:
-    Board m_board;
-    unsigned long int m_milliseconds;
-    bool m_solvable;
-    bool m_solving;
-    bool m_cancelled;
+    // Guards everything below, but not the generation itself, which works
+    // on its own board
+    mutable std::mutex m_mutex;
+    int m_pending_box;
+    unsigned long long int m_pending_seed;
+    unsigned long int m_pending_budget;
+    unsigned long long int m_pending_request;
+    bool m_pending;
+    AnyBoard m_puzzle;
+    unsigned long long int m_request;
 };
 
 class MainWindow : public QMainWindow
@@ -95,22 +224,34 @@ public:
     ~MainWindow();
 
 signals:
-    // Signal to send solver object in solving thread to prompt it to solve
-    // current sudoku
-    void solve();
+    // Signal to the checker to check the latest grid typed
+    void check();
+    // Signal to the puzzle maker to make the puzzle last requested
+    void make();
 
 private slots:
     // UI handlers
     void handle_open();
+    void handle_new_puzzle();
     void handle_solve();
     void handle_clear();
     void handle_save();
     void handle_copy_input_board();
     void handle_copy_output_board();
+    void handle_solver_mode();
+    void handle_size();
+    // Updates the live grid as a field is typed into
+    void handle_edit();
+
+    // Shows the result of a job picked from the job list
+    void handle_job_activated(QListWidgetItem* item);
 
-    // Handler for when the solving of the puzzle ends (not connected to UI
+    // Handler for when a solve ends, or is dropped (not connected to UI
     // directly)
-    void handle_finish_solve();
+    void handle_finish_solve(int id);
+    void handle_finish_check();
+    // Fills the input array with a new puzzle once it is made
+    void handle_finish_generate();
 private:
     // Custom eventFilter function to add handling for arrow and enter keys in
     // input fields
@@ -118,17 +259,38 @@ private:
 
     // Utility functions
     bool update_board();
-    void print_output(unsigned long int milliseconds);
+    // Writes m_in_board into the input array
+    void print_input();
+    // Shows a finished job, if it is still remembered
+    void show_job(int id);
+    void print_output(const AnyBoard& puzzle,
+                      const SolveService::Status& status);
+    // Lists every job the solve service remembers
+    void print_jobs();
     void print_waiting();
-    void print_grid();
     void clear_output();
+    void clear_labels();
     void alert(const std::string& message);
     void copy_board(bool input_board);
 
+    // Rebuilds the live grid from every field, after they were set other
+    // than by typing
+    void reload_live();
+    // Shows the conflicts and candidates of a cell, or of every cell in the
+    // units of one
+    void print_live_cell(int row, int col);
+    void print_live_peers(int row, int col);
+    // Reports what the live grid shows at once, and asks the checker about
+    // the rest
+    void request_check();
+
     // Functions to create elements of UI
     void create_menus();
     void create_input_array();
     void create_output_view();
+    // Places the widgets around the input array, and sizes the window, to
+    // fit the current board size
+    void layout_widgets();
     void create_buttons();
     void create_labels();
     void create_shortcuts();
@@ -136,37 +298,76 @@ private:
     // UI elements
     QMenu* file_menu;
     QAction* open_action;
+    QAction* new_puzzle_action;
     QAction* close_action;
     QAction* save_action;
     QMenu* edit_menu;
     QAction* copy_input_board_action;
     QAction* copy_output_board_action;
+    QMenu* solver_menu;
+    QAction* first_empty_action;
+    QAction* fewest_candidates_action;
+    QAction* dancing_links_action;
+    QMenu* size_menu;
+    QActionGroup* size_group;
 
     QPushButton* solve_button;
     QPushButton* clear_button;
     QGraphicsView* output_view;
     QLabel* timer_label;
     QLabel* count_label;
+    QLabel* solutions_label;
+    QLabel* status_label;
+    QListWidget* job_list;
     QGraphicsScene* output_scene;
-    std::array<std::array<QLineEdit*, 9>, 9> input_array;
+    OutputBoard* output_board;
+    std::vector<std::vector<QLineEdit*>> input_array;
 
     // Shortcuts
     QShortcut* open_shortcut;   
+    QShortcut* new_puzzle_shortcut;
     QShortcut* save_shortcut;
 
+    // Width of the squares of the board, so 3 for a 9 by 9 board
+    int m_box;
+
     // Sudoku boards
-    Board m_in_board;
-    Board m_out_board;
+    AnyBoard m_in_board;
+    AnyBoard m_out_board;
+
+    // What is typed into the input array, kept up to date field by field
+    LiveGrid m_live;
+
+    // Search engine and cell selection strategy used for the next solve
+    AnyBoard::Backend m_backend;
+    AnyBoard::Heuristic m_heuristic;
+
+    // Solving sudokus should be done in other threads to avoid hanging the
+    // ui if the sudoku takes a long time to solve. Several can be solved at
+    // once, and the output shows the job last asked for (or picked from the
+    // job list), 0 if none.
+    SolveService* m_solves;
+    int m_shown_job;
+    // Source given to the next solve, so that solving it again supersedes
+    // the last solve of the same puzzle
+    QString m_source;
+
+    // Checks whether the grid typed so far has a solution, while typing
+    Checker* m_checker;
+    QThread* m_checker_thread;
 
-    // Solving sudokus should be done in another thread to avoid hanging the
-    // ui if the sudoku takes a long time to solve
-    Solver* m_solver;
-    QThread* m_solver_thread;
+    // Makes new puzzles. Requests are numbered, and a puzzle is only shown
+    // if it is for the last one and nothing since replaced the input (such
+    // as opening a file or changing size).
+    PuzzleMaker* m_maker;
+    QThread* m_maker_thread;
+    unsigned long long int m_puzzle_request;
+    bool m_puzzle_wanted;
 
     // Some constants related to the window
     static constexpr int m_big_width = 2;
-    static constexpr int m_small_width = 1;
-    static constexpr int m_size = 240;
+    // Width of the output grid, which grows with the input array
+    int m_size;
 };
 
 #endif // MAINWINDOW_H
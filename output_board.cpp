@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include <QFont>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "output_board.h"
+
+OutputBoard::OutputBoard(int box, int side)
+    : m_thin_pen(Qt::black, 1), m_thick_pen(Qt::black, 2)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    resize(box, side);
+}
+
+void OutputBoard::resize(int box, int side)
+{
+    prepareGeometryChange();
+    m_box = box;
+    m_size = box * box;
+    m_side = side;
+    m_cells.assign(m_size * m_size, 0);
+    m_message.clear();
+    make_glyphs();
+    update();
+}
+
+void OutputBoard::set_cell(int row, int col, int entry, bool given)
+{
+    int& cell = m_cells[row * m_size + col];
+    int value = given ? -entry : entry;
+    if (cell == value) return;
+
+    cell = value;
+    if (m_message.isEmpty()) {
+        update(cell_rect(row, col));
+    }
+}
+
+void OutputBoard::clear()
+{
+    std::fill(m_cells.begin(), m_cells.end(), 0);
+    m_message.clear();
+    update();
+}
+
+void OutputBoard::set_message(const QString& message)
+{
+    if (m_message == message) return;
+    m_message = message;
+    update();
+}
+
+QRectF OutputBoard::boundingRect() const
+{
+    // Leaves room for half the border pen outside the grid
+    return QRectF(-1, -1, m_side + 2, m_side + 2);
+}
+
+void OutputBoard::paint(QPainter* painter,
+                        const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    const QRectF& exposed = option->exposedRect;
+
+    if (!m_message.isEmpty()) {
+        painter->drawText(QRectF(0, 0, m_side, m_side), Qt::AlignCenter,
+                          m_message);
+    } else {
+        for (int row = 0; row < m_size; ++row) {
+            for (int col = 0; col < m_size; ++col) {
+                int value = m_cells[row * m_size + col];
+                QRectF rect = cell_rect(row, col);
+                if (value == 0 || !exposed.intersects(rect)) continue;
+
+                const QPixmap& glyph = value > 0 ? m_plain_glyphs[value] :
+                                                   m_given_glyphs[-value];
+                painter->drawPixmap(rect.topLeft(), glyph);
+            }
+        }
+    }
+
+    for (int i = 1; i < m_size; ++i) {
+        const qreal x = qreal(m_side) * i / m_size;
+        painter->setPen(i % m_box == 0 ? m_thick_pen : m_thin_pen);
+        painter->drawLine(QLineF(x, 0, x, m_side));
+        painter->drawLine(QLineF(0, x, m_side, x));
+    }
+    painter->setPen(m_thick_pen);
+    painter->drawRect(QRectF(0, 0, m_side, m_side));
+}
+
+void OutputBoard::make_glyphs()
+{
+    const int cell = m_side / m_size;
+
+    QFont plain;
+    plain.setPixelSize(std::max(1, m_side * 7 / (10 * m_size)));
+    QFont given = plain;
+    given.setBold(true);
+
+    m_plain_glyphs.assign(m_size + 1, QPixmap());
+    m_given_glyphs.assign(m_size + 1, QPixmap());
+    for (int entry = 1; entry <= m_size; ++entry) {
+        for (bool is_given : { false, true }) {
+            QPixmap glyph(cell, cell);
+            glyph.fill(Qt::transparent);
+
+            QPainter painter(&glyph);
+            painter.setFont(is_given ? given : plain);
+            painter.setPen(is_given ? Qt::red : Qt::black);
+            painter.drawText(glyph.rect(), Qt::AlignCenter,
+                             QString::number(entry));
+            painter.end();
+
+            (is_given ? m_given_glyphs : m_plain_glyphs)[entry] = glyph;
+        }
+    }
+}
+
+QRectF OutputBoard::cell_rect(int row, int col) const
+{
+    return QRectF(qreal(m_side) * col / m_size, qreal(m_side) * row / m_size,
+                  qreal(m_side) / m_size, qreal(m_side) / m_size);
+}
@@ -0,0 +1,63 @@
+#ifndef OUTPUT_BOARD_H
+#define OUTPUT_BOARD_H
+
+#include <vector>
+
+#include <QGraphicsItem>
+#include <QPen>
+#include <QPixmap>
+#include <QString>
+
+/*
+ * The output grid, drawn as one item that lives as long as the scene. Each
+ * number is rendered once per board size into a pixmap, and painting only
+ * copies those pixmaps into the cells that need repainting. Setting a cell
+ * to what it already holds does nothing, and setting it to anything else
+ * repaints that cell alone, so the board can be redrawn as fast as results
+ * arrive without allocating.
+ */
+
+class OutputBoard : public QGraphicsItem {
+public:
+    // Board of box by box squares drawn side pixels wide
+    OutputBoard(int box, int side);
+
+    // Changes the board size or the drawing size, emptying the board
+    void resize(int box, int side);
+
+    // Shows a number in a cell, in red if it was given in the puzzle.
+    // Entry 0 leaves the cell empty.
+    void set_cell(int row, int col, int entry, bool given);
+    // Empties every cell, and removes any message
+    void clear();
+    // Shows a line of text across the middle of the board instead of the
+    // numbers, until the next clear(). An empty message shows the numbers
+    // again.
+    void set_message(const QString& message);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+               QWidget* widget) override;
+private:
+    // Renders every number, plain and given, at the current cell size
+    void make_glyphs();
+
+    QRectF cell_rect(int row, int col) const;
+
+    int m_box;
+    int m_size;
+    int m_side;
+
+    // Entry of each cell, negated for given ones
+    std::vector<int> m_cells;
+    QString m_message;
+
+    // Indexed by entry, 0 to m_size
+    std::vector<QPixmap> m_plain_glyphs;
+    std::vector<QPixmap> m_given_glyphs;
+
+    QPen m_thin_pen;
+    QPen m_thick_pen;
+};
+
+#endif // OUTPUT_BOARD_H
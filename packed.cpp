@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cstring>
+
+#include "packed.h"
+
+constexpr int PackedBoard::bytes;
+
+namespace {
+
+void put_u32(unsigned char* out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void put_u64(unsigned char* out, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+std::uint32_t get_u32(const unsigned char* in)
+{
+    std::uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+std::uint64_t get_u64(const unsigned char* in)
+{
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+std::uint32_t checksum(const unsigned char* bytes, std::size_t size)
+{
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Index entries are 16 bytes, after 16 bytes of block size and count
+constexpr std::size_t index_entry_size = 16;
+
+} // namespace
+
+void PackedBoard::pack(const Board& board)
+{
+    // Row by row and a byte at a time rather than through set(), as streams
+    // of solutions are packed as fast as they are found
+    std::array<int, 82> cells;
+    for (int row = 0; row < 9; ++row) {
+        const std::array<int, 9>& entries = board[row];
+        std::copy(entries.begin(), entries.end(), cells.begin() + row * 9);
+    }
+    cells[81] = 0;
+    for (int i = 0; i < 41; ++i) {
+        m_bytes[i] = static_cast<unsigned char>(
+            (cells[2 * i] & 0xf) | (cells[2 * i + 1] & 0xf) << 4);
+    }
+}
+
+void PackedBoard::unpack(Board& board) const
+{
+    for (int row = 0; row < 9; ++row) {
+        std::array<int, 9>& entries = board[row];
+        for (int col = 0; col < 9; ++col) {
+            entries[col] = at(row * 9 + col);
+        }
+    }
+}
+
+void PackedBoard::set(int cell, int entry)
+{
+    const int shift = cell % 2 * 4;
+    unsigned char& byte = m_bytes[cell / 2];
+    byte = static_cast<unsigned char>((byte & ~(0xf << shift)) |
+                                      ((entry & 0xf) << shift));
+}
+
+bool read_packed_header(const unsigned char* bytes, PackedHeader& header)
+{
+    if (std::memcmp(bytes, packed_magic, sizeof(packed_magic)) != 0 ||
+            get_u32(bytes + 8) != packed_version ||
+            get_u32(bytes + 12) != PackedBoard::bytes) {
+        return false;
+    }
+    header.count = get_u64(bytes + 16);
+    header.index_offset = get_u64(bytes + 24);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+PackedWriter::PackedWriter()
+    : m_file(nullptr), m_block_count(0), m_count(0), m_failed(false)
+{}
+
+PackedWriter::~PackedWriter()
+{
+    close();
+}
+
+bool PackedWriter::open(const std::string& file_name)
+{
+    close();
+
+    m_file = std::fopen(file_name.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    m_block.resize(packed_block_records * PackedBoard::bytes);
+    m_block_count = 0;
+    m_index.clear();
+    m_count = 0;
+    m_failed = false;
+
+    // Left unfinished until close()
+    unsigned char header[packed_header_size] = {};
+    std::memcpy(header, packed_magic, sizeof(packed_magic));
+    put_u32(header + 8, packed_version);
+    put_u32(header + 12, PackedBoard::bytes);
+    if (std::fwrite(header, sizeof(header), 1, m_file) != 1) {
+        m_failed = true;
+    }
+    return true;
+}
+
+void PackedWriter::write(const PackedBoard& board)
+{
+    std::memcpy(&m_block[m_block_count * PackedBoard::bytes], board.data(),
+                PackedBoard::bytes);
+    m_count++;
+    if (++m_block_count == packed_block_records) {
+        write_block();
+    }
+}
+
+void PackedWriter::write_block()
+{
+    if (m_block_count == 0) return;
+
+    const std::size_t size = m_block_count * PackedBoard::bytes;
+    Block block;
+    block.offset = packed_header_size +
+                   (m_count - m_block_count) * PackedBoard::bytes;
+    block.count = static_cast<std::uint32_t>(m_block_count);
+    block.checksum = checksum(m_block.data(), size);
+    m_index.push_back(block);
+
+    if (std::fwrite(m_block.data(), 1, size, m_file) != size) {
+        m_failed = true;
+    }
+    m_block_count = 0;
+}
+
+bool PackedWriter::close()
+{
+    if (!m_file) {
+        return !m_failed;
+    }
+    write_block();
+
+    const std::uint64_t index_offset =
+        packed_header_size + m_count * PackedBoard::bytes;
+    std::vector<unsigned char> index(16 + m_index.size() * index_entry_size);
+    put_u64(&index[0], packed_block_records);
+    put_u64(&index[8], m_index.size());
+    for (std::size_t i = 0; i < m_index.size(); ++i) {
+        unsigned char* entry = &index[16 + i * index_entry_size];
+        put_u64(entry, m_index[i].offset);
+        put_u32(entry + 8, m_index[i].count);
+        put_u32(entry + 12, m_index[i].checksum);
+    }
+    if (std::fwrite(index.data(), 1, index.size(), m_file) != index.size()) {
+        m_failed = true;
+    }
+
+    unsigned char fields[16];
+    put_u64(fields, m_count);
+    put_u64(fields + 8, index_offset);
+    if (std::fseek(m_file, 16, SEEK_SET) != 0 ||
+            std::fwrite(fields, sizeof(fields), 1, m_file) != 1) {
+        m_failed = true;
+    }
+
+    if (std::fclose(m_file) != 0) {
+        m_failed = true;
+    }
+    m_file = nullptr;
+    return !m_failed;
+}
+
+// ----------------------------------------------------------------------------
+
+PackedReader::PackedReader()
+    : m_file(nullptr), m_count(0), m_next(0), m_index_offset(0)
+{}
+
+PackedReader::~PackedReader()
+{
+    close();
+}
+
+bool PackedReader::open(const std::string& file_name)
+{
+    close();
+
+    m_file = std::fopen(file_name.c_str(), "rb");
+    if (!m_file) {
+        return false;
+    }
+
+    unsigned char bytes[packed_header_size];
+    PackedHeader header;
+    if (std::fread(bytes, sizeof(bytes), 1, m_file) != 1 ||
+            !read_packed_header(bytes, header)) {
+        close();
+        return false;
+    }
+
+    m_index_offset = header.index_offset;
+    m_count = header.count;
+    if (m_index_offset == 0) {
+        // Never finished, so count the whole records there are
+        std::fseek(m_file, 0, SEEK_END);
+        long size = std::ftell(m_file);
+        m_count = (size - static_cast<long>(packed_header_size)) /
+                  PackedBoard::bytes;
+        std::fseek(m_file, packed_header_size, SEEK_SET);
+    }
+    m_next = 0;
+    return true;
+}
+
+void PackedReader::close()
+{
+    if (m_file) {
+        std::fclose(m_file);
+    }
+    m_file = nullptr;
+    m_count = 0;
+    m_next = 0;
+    m_index_offset = 0;
+}
+
+std::size_t PackedReader::read(PackedBoard* out, std::size_t max)
+{
+    if (!m_file) return 0;
+
+    if (max > m_count - m_next) {
+        max = static_cast<std::size_t>(m_count - m_next);
+    }
+    std::size_t read = std::fread(out, PackedBoard::bytes, max, m_file);
+    m_next += read;
+    return read;
+}
+
+bool PackedReader::next(Board& board)
+{
+    PackedBoard packed;
+    if (!next(packed)) return false;
+    packed.unpack(board);
+    return true;
+}
+
+bool PackedReader::seek(unsigned long long int record)
+{
+    if (!m_file || record > m_count) return false;
+
+    long offset = static_cast<long>(packed_header_size +
+                                    record * PackedBoard::bytes);
+    if (std::fseek(m_file, offset, SEEK_SET) != 0) return false;
+    m_next = record;
+    return true;
+}
+
+bool PackedReader::verify()
+{
+    if (!m_file || m_index_offset == 0) return false;
+
+    const unsigned long long int next = m_next;
+    unsigned char fields[16];
+    long file_size = -1;
+    if (std::fseek(m_file, 0, SEEK_END) == 0) file_size = std::ftell(m_file);
+    if (file_size < 0 ||
+            std::fseek(m_file, static_cast<long>(m_index_offset),
+                       SEEK_SET) != 0 ||
+            std::fread(fields, sizeof(fields), 1, m_file) != 1) {
+        seek(next);
+        return false;
+    }
+    const std::uint64_t blocks = get_u64(fields + 8);
+
+    // The number of blocks comes from the file, so it is checked against
+    // the records and the rest of the file before anything is allocated for
+    // it. The fields were read, so they lie within the file.
+    const std::uint64_t size_left = static_cast<std::uint64_t>(file_size) -
+                                    m_index_offset - sizeof(fields);
+    if (blocks > m_count / packed_block_records + 1 ||
+            blocks > size_left / index_entry_size) {
+        seek(next);
+        return false;
+    }
+
+    std::vector<unsigned char> index(
+        static_cast<std::size_t>(blocks) * index_entry_size);
+    bool ok = (std::fread(index.data(), 1, index.size(), m_file) ==
+               index.size());
+
+    std::vector<unsigned char> block;
+    std::uint64_t records = 0;
+    for (std::uint64_t i = 0; ok && i < blocks; ++i) {
+        const unsigned char* entry = &index[i * index_entry_size];
+        if (get_u32(entry + 8) > packed_block_records) {
+            ok = false;
+            break;
+        }
+        const std::size_t size = get_u32(entry + 8) * PackedBoard::bytes;
+        block.resize(size);
+        ok = std::fseek(m_file, static_cast<long>(get_u64(entry)),
+                        SEEK_SET) == 0 &&
+             std::fread(block.data(), 1, size, m_file) == size &&
+             checksum(block.data(), size) == get_u32(entry + 12);
+        records += get_u32(entry + 8);
+    }
+
+    seek(next);
+    return ok && records == m_count;
+}
@@ -0,0 +1,161 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sudoku.h"
+
+/*
+ * Compact storage for 9 by 9 boards. A PackedBoard holds two cells to a
+ * byte, low nibble first, in 41 bytes against the few hundred of a Board,
+ * so that large batches of puzzles fit in memory.
+ *
+ * Packed files hold a header, the records back to back, and an index. All
+ * numbers are little endian.
+ *
+ *   header   8 bytes of magic "SUDOKUPK", u32 version (1), u32 record size
+ *            (41), u64 record count, u64 offset of the index
+ *   records  41 bytes each, written in blocks of packed_block_records
+ *   index    u64 records per block, u64 number of blocks, then for each
+ *            block its u64 offset, u32 record count and u32 checksum (the
+ *            32 bit FNV-1a hash of its bytes)
+ *
+ * Writers fill in the record count and index offset as they close, so a
+ * file whose index offset is 0 was never finished. Its records can still be
+ * read, up to the last whole one. PuzzleReader reads packed files as well
+ * as text.
+ */
+
+constexpr char packed_magic[8] = { 'S', 'U', 'D', 'O', 'K', 'U', 'P', 'K' };
+constexpr std::uint32_t packed_version = 1;
+constexpr std::size_t packed_header_size = 32;
+constexpr std::size_t packed_block_records = 1 << 16;
+
+class PackedBoard {
+public:
+    static constexpr int bytes = 41;
+
+    PackedBoard() : m_bytes() {}
+    explicit PackedBoard(const Board& board) { pack(board); }
+
+    void pack(const Board& board);
+    // Overwrites the grid of board, leaving its settings alone
+    void unpack(Board& board) const;
+
+    // Number in a cell (as row*9+col), 0 for an unfilled one
+    int at(int cell) const
+    {
+        return (m_bytes[cell / 2] >> (cell % 2 * 4)) & 0xf;
+    }
+    void set(int cell, int entry);
+
+    const unsigned char* data() const { return m_bytes.data(); }
+    unsigned char* data() { return m_bytes.data(); }
+
+    bool operator==(const PackedBoard& other) const
+    {
+        return m_bytes == other.m_bytes;
+    }
+private:
+    std::array<unsigned char, bytes> m_bytes;
+};
+
+static_assert(sizeof(PackedBoard) == PackedBoard::bytes,
+              "packed boards are read and written as raw bytes");
+
+// Header fields of a packed file, and whether the first bytes of a file
+// (at least packed_header_size of them) are one. The count and index
+// offset are 0 in files that were never finished.
+struct PackedHeader {
+    std::uint64_t count;
+    std::uint64_t index_offset;
+};
+bool read_packed_header(const unsigned char* bytes, PackedHeader& header);
+
+/*
+ * Streams boards into a packed file, a block at a time.
+ */
+
+class PackedWriter {
+public:
+    PackedWriter();
+    ~PackedWriter();
+
+    PackedWriter(const PackedWriter&) = delete;
+    PackedWriter& operator=(const PackedWriter&) = delete;
+
+    // Creates or truncates a file. Returns false if it can't be opened.
+    bool open(const std::string& file_name);
+
+    void write(const PackedBoard& board);
+    void write(const Board& board) { write(PackedBoard(board)); }
+
+    // Writes out the last block and the index, and fills in the header.
+    // Returns false if anything failed to write.
+    bool close();
+
+    unsigned long long int count() const { return m_count; }
+private:
+    struct Block {
+        std::uint64_t offset;
+        std::uint32_t count;
+        std::uint32_t checksum;
+    };
+
+    void write_block();
+
+    std::FILE* m_file;
+    std::vector<unsigned char> m_block;
+    std::size_t m_block_count;
+    std::vector<Block> m_index;
+    unsigned long long int m_count;
+    bool m_failed;
+};
+
+/*
+ * Reads boards from a packed file, straight into memory in bulk, or one at
+ * a time.
+ */
+
+class PackedReader {
+public:
+    PackedReader();
+    ~PackedReader();
+
+    PackedReader(const PackedReader&) = delete;
+    PackedReader& operator=(const PackedReader&) = delete;
+
+    // Returns false if the file can't be opened or isn't a packed file
+    bool open(const std::string& file_name);
+    void close();
+
+    unsigned long long int count() const { return m_count; }
+    // Whether the file was finished, and so has an index to verify()
+    bool indexed() const { return m_index_offset != 0; }
+
+    // Reads up to max boards into out. Returns how many were read, 0 at
+    // the end of the file.
+    std::size_t read(PackedBoard* out, std::size_t max);
+    bool next(PackedBoard& board) { return read(&board, 1) == 1; }
+    bool next(Board& board);
+
+    // Moves to the given record. Returns false if it is past the end.
+    bool seek(unsigned long long int record);
+
+    // Checks every block against its checksum in the index. Returns false
+    // if one doesn't match, if the index doesn't fit the file, or if the
+    // file has no index.
+    bool verify();
+private:
+    std::FILE* m_file;
+    unsigned long long int m_count;
+    unsigned long long int m_next;
+    std::uint64_t m_index_offset;
+};
+
+#endif // PACKED_H
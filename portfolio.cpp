@@ -0,0 +1,110 @@
+#include "portfolio.h"
+
+template <int Box>
+std::vector<typename Portfolio<Box>::Strategy>
+Portfolio<Box>::default_strategies()
+{
+    return {
+        {"row-major", BoardBase::Backend::backtracking,
+         BoardBase::Heuristic::first_empty,
+         BoardBase::ValueOrder::ascending, 0},
+        {"fewest", BoardBase::Backend::backtracking,
+         BoardBase::Heuristic::fewest_candidates,
+         BoardBase::ValueOrder::ascending, 0},
+        {"random", BoardBase::Backend::backtracking,
+         BoardBase::Heuristic::fewest_candidates,
+         BoardBase::ValueOrder::random, 256},
+        {"reversed", BoardBase::Backend::backtracking,
+         BoardBase::Heuristic::first_empty,
+         BoardBase::ValueOrder::descending, 0},
+    };
+}
+
+template <int Box>
+Portfolio<Box>::Portfolio(const std::vector<Strategy>& strategies)
+    : m_strategies(strategies), m_boards(strategies.size()),
+      m_found(strategies.size(), 0), m_wins(strategies.size(), 0),
+      m_time_budget(0), m_node_budget(0), m_seed(0),
+      m_collect_stats(false), m_first(-1), m_winner(-1),
+      m_result(BoardBase::Result::unsolvable), m_cancel(false),
+      m_pool(static_cast<int>(strategies.size()))
+{}
+
+template <int Box>
+unsigned long int Portfolio<Box>::count_solutions(const Board& puzzle,
+                                                  unsigned long int limit)
+{
+    m_first = -1;
+
+    // Every board is set up before any search starts, so that the winner
+    // can cancel boards whose search hasn't started yet
+    for (std::size_t i = 0; i < m_strategies.size(); ++i) {
+        const Strategy& strategy = m_strategies[i];
+        Board& board = m_boards[i];
+        board = puzzle;
+        board.set_backend(strategy.backend);
+        board.set_heuristic(strategy.heuristic);
+        board.set_value_order(strategy.value_order);
+        board.set_restart_unit(strategy.restart_unit);
+        board.set_seed(m_seed);
+        board.set_time_budget(m_time_budget);
+        board.set_node_budget(m_node_budget);
+        board.set_collect_stats(m_collect_stats);
+        m_found[i] = 0;
+    }
+    // A cancel() that came while the boards were copied is passed on here
+    if (m_cancel.get()) cancel();
+
+    for (std::size_t i = 0; i < m_strategies.size(); ++i) {
+        m_pool.submit([this, i, limit](int) {
+            Board& board = m_boards[i];
+            m_found[i] = board.count_solutions(limit);
+
+            // Only a finished search settles the puzzle
+            BoardBase::Result result = board.result();
+            if (result == BoardBase::Result::cancelled ||
+                    result == BoardBase::Result::budget_exceeded) {
+                return;
+            }
+            int none = -1;
+            if (m_first.compare_exchange_strong(none, static_cast<int>(i))) {
+                for (std::size_t j = 0; j < m_boards.size(); ++j) {
+                    if (j != i) m_boards[j].cancel();
+                }
+            }
+        });
+    }
+    m_pool.wait();
+
+    m_winner = m_first;
+    if (m_winner >= 0) {
+        m_wins[m_winner]++;
+        m_result = m_boards[m_winner].result();
+        return m_found[m_winner];
+    }
+
+    // Nobody settled it: either the race was cancelled, or every strategy
+    // ran out of budget
+    m_result = BoardBase::Result::cancelled;
+    for (const Board& board : m_boards) {
+        if (board.result() == BoardBase::Result::budget_exceeded) {
+            m_result = BoardBase::Result::budget_exceeded;
+        }
+    }
+    if (m_cancel.get()) m_result = BoardBase::Result::cancelled;
+    return 0;
+}
+
+template <int Box>
+void Portfolio<Box>::cancel()
+{
+    m_cancel.set(true);
+    for (Board& board : m_boards) {
+        board.cancel();
+    }
+}
+
+template class Portfolio<2>;
+template class Portfolio<3>;
+template class Portfolio<4>;
+template class Portfolio<5>;
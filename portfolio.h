@@ -0,0 +1,115 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sudoku.h"
+#include "thread_pool.h"
+
+/*
+ * Races several strategies on one puzzle, each on its own thread, and takes
+ * the answer of whichever settles it first, cancelling the rest. A puzzle
+ * that is pathological for one way of searching, such as one built against
+ * trying numbers in order on the first empty cell, is then only as slow as
+ * the best strategy for it. Every race records its winner, so that a run
+ * over many puzzles shows which strategy makes the best default.
+ *
+ * The threads are started with the portfolio and kept for every race. One
+ * race runs at a time; cancel() may be called from any thread.
+ */
+
+template <int Box>
+class Portfolio {
+public:
+    typedef BasicBoard<Box> Board;
+
+    struct Strategy {
+        std::string name;
+        BoardBase::Backend backend;
+        BoardBase::Heuristic heuristic;
+        BoardBase::ValueOrder value_order;
+        // See Board::set_restart_unit()
+        unsigned long int restart_unit;
+    };
+
+    // Row-major and fewest candidates with numbers tried from 1 up, fewest
+    // candidates with random choices and restarts, and row-major with
+    // numbers tried from the largest down
+    static std::vector<Strategy> default_strategies();
+
+    explicit Portfolio(
+        const std::vector<Strategy>& strategies = default_strategies());
+
+    Portfolio(const Portfolio&) = delete;
+    Portfolio& operator=(const Portfolio&) = delete;
+
+    const std::vector<Strategy>& strategies() const { return m_strategies; }
+
+    // Limits on the search of each strategy, as on Board. 0 means no limit.
+    void set_time_budget(std::chrono::milliseconds budget)
+    {
+        m_time_budget = budget;
+    }
+    void set_node_budget(unsigned long int budget) { m_node_budget = budget; }
+    // Seeds the strategies that make random choices. Every race starts from
+    // the same seed.
+    void set_seed(std::uint64_t seed) { m_seed = seed; }
+    // Whether each strategy's board fills in its stats
+    void set_collect_stats(bool collect) { m_collect_stats = collect; }
+
+    // Searches puzzle with every strategy at once, until one has found limit
+    // solutions or shown that there are fewer, and returns the number it
+    // found (see Board::count_solutions())
+    unsigned long int count_solutions(const Board& puzzle,
+                                      unsigned long int limit);
+
+    // Outcome of the last race: the winner's, or budget_exceeded or
+    // cancelled if there was no winner
+    BoardBase::Result result() const { return m_result; }
+    // Index of the strategy that won the last race, or -1 if none did
+    int winner() const { return m_winner; }
+    // Board of the winning strategy, holding the first solution found, or of
+    // the first strategy if none won
+    const Board& solution() const
+    {
+        return m_boards[m_winner < 0 ? 0 : m_winner];
+    }
+    // Board each strategy searched in the last race, its counts covering
+    // the search up to when it won or was cancelled
+    const Board& board(int strategy) const { return m_boards[strategy]; }
+
+    // Races won by each strategy since the portfolio was made
+    const std::vector<unsigned long int>& wins() const { return m_wins; }
+
+    // Cancels the running race and every later one
+    void cancel();
+private:
+    std::vector<Strategy> m_strategies;
+    std::vector<Board> m_boards;
+    std::vector<unsigned long int> m_found;
+    std::vector<unsigned long int> m_wins;
+
+    std::chrono::milliseconds m_time_budget;
+    unsigned long int m_node_budget;
+    std::uint64_t m_seed;
+    bool m_collect_stats;
+
+    // Taken by the first strategy to settle the puzzle
+    std::atomic<int> m_first;
+    int m_winner;
+    BoardBase::Result m_result;
+    AtomicFlag m_cancel;
+
+    ThreadPool m_pool;
+};
+
+extern template class Portfolio<2>;
+extern template class Portfolio<3>;
+extern template class Portfolio<4>;
+extern template class Portfolio<5>;
+
+#endif // PORTFOLIO_H
@@ -0,0 +1,345 @@
+#include <array>
+#include <climits>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "puzzle_reader.h"
+
+namespace {
+
+// Stream buffer size, and how much unread data stream mode keeps available
+// before parsing a record. Records longer than this are reported as
+// malformed.
+constexpr std::size_t buffer_size = 1 << 20;
+constexpr std::size_t record_window = 1 << 16;
+
+// A bad line shorter than this, in characters other than formatting, is
+// taken for a row of a nine line record rather than an 81 digit record
+constexpr int longest_row = 27;
+
+// Characters that may surround the digits of a record
+inline bool formatting(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
+           ch == '|' || ch == '+' || ch == '-';
+}
+
+} // namespace
+
+PuzzleReader::PuzzleReader()
+    : m_pos(nullptr), m_end(nullptr), m_map(nullptr), m_map_size(0),
+      m_stream(nullptr), m_eof(true), m_detected(false), m_packed(false),
+      m_packed_left(0), m_base_offset(0), m_base(nullptr),
+      m_record_offset(0), m_error_offset(0)
+{}
+
+PuzzleReader::~PuzzleReader()
+{
+    close();
+}
+
+bool PuzzleReader::open(const std::string& file_name)
+{
+    close();
+
+#if defined(_WIN32)
+    // No mapping here, read the whole file into the buffer instead
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    m_buffer.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    m_base = m_pos = m_buffer.data();
+    m_end = m_pos + m_buffer.size();
+    detect();
+    return true;
+#else
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_map_size = static_cast<std::size_t>(info.st_size);
+    if (m_map_size > 0) {
+        m_map = mmap(nullptr, m_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (m_map_size == 0 || m_map == MAP_FAILED) {
+        // Empty files can't be mapped, and aren't worth mapping
+        bool empty = (m_map_size == 0);
+        m_map = nullptr;
+        m_map_size = 0;
+        return empty;
+    }
+    posix_madvise(m_map, m_map_size, POSIX_MADV_SEQUENTIAL);
+
+    m_base = m_pos = static_cast<const char*>(m_map);
+    m_end = m_pos + m_map_size;
+    detect();
+    return true;
+#endif
+}
+
+void PuzzleReader::open(std::FILE* stream)
+{
+    close();
+
+    m_stream = stream;
+    m_eof = false;
+    m_buffer.resize(buffer_size);
+    m_base = m_pos = m_end = m_buffer.data();
+}
+
+void PuzzleReader::close()
+{
+#if !defined(_WIN32)
+    if (m_map) {
+        munmap(m_map, m_map_size);
+    }
+#endif
+    m_map = nullptr;
+    m_map_size = 0;
+    m_stream = nullptr;
+    m_eof = true;
+    m_detected = false;
+    m_packed = false;
+    m_packed_left = 0;
+    m_base = m_pos = m_end = nullptr;
+    m_base_offset = 0;
+}
+
+void PuzzleReader::refill()
+{
+    std::size_t unread = m_end - m_pos;
+    m_base_offset += m_pos - m_base;
+    std::memmove(m_buffer.data(), m_pos, unread);
+
+    m_base = m_pos = m_buffer.data();
+    m_end = m_pos + unread;
+
+    while (!m_eof && static_cast<std::size_t>(m_end - m_pos) < buffer_size) {
+        std::size_t space = buffer_size - (m_end - m_pos);
+        std::size_t read = std::fread(m_buffer.data() + (m_end - m_pos), 1,
+                                      space, m_stream);
+        m_end += read;
+        if (read < space) {
+            m_eof = true;
+        }
+    }
+}
+
+void PuzzleReader::detect()
+{
+    m_detected = true;
+
+    PackedHeader header;
+    if (static_cast<std::size_t>(m_end - m_pos) < packed_header_size ||
+            !read_packed_header(reinterpret_cast<const unsigned char*>(m_pos),
+                                header)) {
+        return;
+    }
+    m_packed = true;
+    m_pos += packed_header_size;
+
+    // Unfinished files have no count, and end at their last whole record
+    m_packed_left = header.index_offset != 0 ? header.count : ULLONG_MAX;
+}
+
+void PuzzleReader::skip_line()
+{
+    const void* newline = std::memchr(m_pos, '\n', m_end - m_pos);
+    m_pos = newline ? static_cast<const char*>(newline) + 1 : m_end;
+}
+
+void PuzzleReader::skip_record(int rows)
+{
+    while (rows < 9 && m_pos != m_end) {
+        bool blank = true;
+        int length = 0;
+        const char* pos = m_pos;
+        for (; pos != m_end && *pos != '\n'; ++pos) {
+            if (*pos != ' ' && *pos != '\t' && *pos != '\r') blank = false;
+            if (!formatting(*pos)) ++length;
+        }
+        // A line too long for a row starts the next record
+        if (blank || length >= longest_row) return;
+
+        // Lines drawn between the boxes aren't rows
+        if (length > 0) ++rows;
+        m_pos = pos;
+        if (m_pos != m_end) ++m_pos;
+    }
+}
+
+PuzzleReader::Status PuzzleReader::next(Board& b)
+{
+    if (m_stream && !m_eof &&
+            static_cast<std::size_t>(m_end - m_pos) < record_window) {
+        refill();
+    }
+    if (!m_detected) {
+        detect();
+    }
+
+    if (m_packed) {
+        PackedBoard packed;
+        Status status = read_packed(packed);
+        if (status == Status::ok) {
+            packed.unpack(b);
+        }
+        return status;
+    }
+
+    std::array<std::array<int, 9>, 9> grid;
+    Status status = parse(grid);
+    if (status == Status::ok) {
+        b = Board(grid);
+    }
+    return status;
+}
+
+PuzzleReader::Status PuzzleReader::next(PackedBoard& b)
+{
+    if (m_stream && !m_eof &&
+            static_cast<std::size_t>(m_end - m_pos) < record_window) {
+        refill();
+    }
+    if (!m_detected) {
+        detect();
+    }
+
+    if (m_packed) {
+        return read_packed(b);
+    }
+
+    std::array<std::array<int, 9>, 9> grid;
+    Status status = parse(grid);
+    if (status == Status::ok) {
+        b = PackedBoard();
+        for (int cell = 0; cell < 81; ++cell) {
+            b.set(cell, grid[cell / 9][cell % 9]);
+        }
+    }
+    return status;
+}
+
+PuzzleReader::Status PuzzleReader::read_packed(PackedBoard& b)
+{
+    if (m_packed_left == 0 ||
+            static_cast<std::size_t>(m_end - m_pos) < PackedBoard::bytes) {
+        return Status::end;
+    }
+    m_record_offset = m_base_offset + (m_pos - m_base);
+    std::memcpy(b.data(), m_pos, PackedBoard::bytes);
+    m_pos += PackedBoard::bytes;
+    m_packed_left--;
+
+    for (int cell = 0; cell < 81; ++cell) {
+        if (b.at(cell) > 9) {
+            m_error_offset = m_record_offset + cell / 2;
+            return Status::malformed;
+        }
+    }
+    return Status::ok;
+}
+
+PuzzleReader::Status PuzzleReader::parse(
+        std::array<std::array<int, 9>, 9>& grid)
+{
+
+    // Skip anything between records: blank lines, comments, and the lines
+    // drawn around boxed boards
+    while (m_pos != m_end) {
+        if (*m_pos == '#') {
+            skip_line();
+        } else if (formatting(*m_pos)) {
+            ++m_pos;
+        } else {
+            break;
+        }
+
+        if (m_stream && !m_eof && m_pos == m_end) {
+            refill();
+        }
+    }
+    if (m_pos == m_end) {
+        return Status::end;
+    }
+    m_record_offset = m_base_offset + (m_pos - m_base);
+
+    int cells = 0;
+    // Every line of a record holds either all 81 numbers or a row of nine
+    int line_cells = 0;
+    // Rows of nine read so far, and where the line being read starts
+    int rows = 0;
+    const char* line = m_pos;
+    const char* pos = m_pos;
+    while (cells < 81 && pos != m_end) {
+        char ch = *pos;
+        if (ch >= '0' && ch <= '9') {
+            grid[cells / 9][cells % 9] = ch - '0';
+            ++cells;
+            ++line_cells;
+        } else if (ch == '.') {
+            grid[cells / 9][cells % 9] = 0;
+            ++cells;
+            ++line_cells;
+        } else if (ch == '\n') {
+            if (line_cells != 0 && line_cells != 9) break;
+            if (line_cells == 9) ++rows;
+            line_cells = 0;
+            line = pos + 1;
+        } else if (!formatting(ch)) {
+            break;
+        }
+        ++pos;
+    }
+
+    // The rest of the line holding the last digit may only be formatting
+    if (cells == 81) {
+        while (pos != m_end && *pos != '\n' && formatting(*pos)) {
+            ++pos;
+        }
+    }
+
+    if (cells < 81 || (pos != m_end && *pos != '\n') ||
+            (line_cells != 9 && line_cells != 81)) {
+        m_error_offset = m_base_offset + (pos - m_base);
+        m_pos = pos;
+        if (m_pos != m_end && *m_pos != '\n') {
+            skip_line();
+        } else if (m_pos != m_end) {
+            ++m_pos;
+        }
+
+        // A bad row of a nine line record takes the rest of the record
+        // with it, so that its other rows aren't read as another record
+        int line_length = 0;
+        for (const char* c = line; c != m_pos && *c != '\n'; ++c) {
+            if (!formatting(*c)) ++line_length;
+        }
+        if (rows > 0 || line_length < longest_row) {
+            skip_record(rows + 1);
+        }
+        return Status::malformed;
+    }
+
+    m_pos = pos;
+    return Status::ok;
+}
@@ -0,0 +1,106 @@
+#ifndef PUZZLE_READER_H
+#define PUZZLE_READER_H
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "packed.h"
+#include "sudoku.h"
+
+/*
+ * Reads a stream of boards without going through std::istream. Files are
+ * memory mapped and parsed in place; standard input is read through one
+ * reusable buffer. Each record may be written on one line as 81 digits, or
+ * over nine lines in either of the formats operator>> accepts (with or
+ * without the boxes drawn around the squares). '0' or '.' mark unfilled
+ * squares, and blank lines and lines starting with '#' are skipped.
+ *
+ * Input that starts with the header of a packed file (see packed.h) is read
+ * as one instead, record by record without any parsing.
+ */
+
+class PuzzleReader {
+public:
+    enum class Status {
+        // A board was read
+        ok,
+        // The next record was malformed, see error_offset(). Reading carries
+        // on from the line after the error.
+        malformed,
+        // There are no more records
+        end
+    };
+
+    PuzzleReader();
+    ~PuzzleReader();
+
+    PuzzleReader(const PuzzleReader&) = delete;
+    PuzzleReader& operator=(const PuzzleReader&) = delete;
+
+    // Maps a file for reading. Returns false if it can't be opened.
+    bool open(const std::string& file_name);
+
+    // Reads from an already open stream, such as stdin
+    void open(std::FILE* stream);
+
+    // Parses the next record straight into b. On failure b may have been
+    // partly overwritten.
+    Status next(Board& b);
+    Status next(PackedBoard& b);
+
+    // Byte offset of the start of the last record read, and of the
+    // character that made the last malformed record fail
+    unsigned long long int offset() const { return m_record_offset; }
+    unsigned long long int error_offset() const { return m_error_offset; }
+private:
+    void close();
+
+    // Checks for the header of a packed file once enough input is there
+    void detect();
+
+    // Reads the next text record into grid, or the next packed one into b
+    Status parse(std::array<std::array<int, 9>, 9>& grid);
+    Status read_packed(PackedBoard& b);
+
+    // In stream mode, moves unread data to the front of the buffer and reads
+    // more, so that a whole record is in memory
+    void refill();
+
+    // Skips to just after the next newline
+    void skip_line();
+
+    // Skips the rest of a nine line record that failed on one of its
+    // lines, m_pos being just after that line and rows lines holding cells
+    // having been read, up to its ninth such line, a blank line, or a line
+    // too long to be a row
+    void skip_record(int rows);
+
+    const char* m_pos;
+    const char* m_end;
+
+    // Mapped file, if any
+    void* m_map;
+    std::size_t m_map_size;
+
+    // Stream and its buffer, if reading from a stream
+    std::FILE* m_stream;
+    std::vector<char> m_buffer;
+    bool m_eof;
+
+    // Whether detect() has run, whether the input is packed, and how many
+    // packed records are left
+    bool m_detected;
+    bool m_packed;
+    unsigned long long int m_packed_left;
+
+    // Offset of m_pos from the start of the input is m_pos - m_base
+    unsigned long long int m_base_offset;
+    const char* m_base;
+
+    unsigned long long int m_record_offset;
+    unsigned long long int m_error_offset;
+};
+
+#endif // PUZZLE_READER_H
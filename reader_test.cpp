@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "puzzle_reader.h"
+
+/*
+ * Checks that PuzzleReader gets back in step after a malformed record: the
+ * bad record is reported once, as one malformed status, and every record
+ * after it is read whole. Each input is read both from a stream and from a
+ * mapped file. Prints what failed and returns 1 if anything did.
+ */
+
+namespace {
+
+const char* const puzzles[] = {
+    "003020600900305001001806400008102900700000008006708200002609500800203009"
+    "005010300",
+    "200080300060070084030500209000105408000000000402706000301007040720040060"
+    "004010003",
+    "000000907000420180000705026100904000050000040000507009920108000034059000"
+    "507000000",
+};
+
+// A puzzle as nine lines of digits, or with the boxes drawn around them,
+// with an 'x' in row bad_row if it is one of the rows
+std::string rows(const std::string& puzzle, bool boxed, int bad_row = -1)
+{
+    std::string text;
+    for (int row = 0; row < 9; ++row) {
+        if (boxed && (row == 3 || row == 6)) {
+            text += "------+-------+------\n";
+        }
+        std::string line = puzzle.substr(row * 9, 9);
+        if (row == bad_row) line[4] = 'x';
+        if (boxed) {
+            std::string drawn;
+            for (int col = 0; col < 9; ++col) {
+                if (col > 0) drawn += (col % 3 == 0) ? " | " : " ";
+                drawn += line[col];
+            }
+            line = drawn;
+        }
+        text += line + '\n';
+    }
+    return text;
+}
+
+struct Case {
+    const char* name;
+    std::string text;
+    // The puzzle each record should hold, or "" for a malformed one
+    std::vector<std::string> records;
+};
+
+std::vector<Case> cases()
+{
+    const std::string a = puzzles[0], b = puzzles[1], c = puzzles[2];
+    return {
+        {"boxed, bad row 3, blank lines between",
+         rows(a, true) + '\n' + rows(b, true, 2) + '\n' + rows(c, true),
+         {a, "", c}},
+        {"boxed, bad row 3, records back to back",
+         rows(a, true) + rows(b, true, 2) + rows(c, true), {a, "", c}},
+        {"nine lines, bad first row",
+         rows(a, false) + rows(b, false, 0) + rows(c, false), {a, "", c}},
+        {"nine lines, bad last row",
+         rows(a, false) + rows(b, false, 8) + rows(c, false), {a, "", c}},
+        {"single lines, stray line between",
+         a + "\nhello\n" + b + '\n' + c + '\n', {a, "", b, c}},
+        {"single lines, short record",
+         a + '\n' + b.substr(0, 80) + '\n' + c + '\n', {a, "", c}},
+    };
+}
+
+std::string digits(const Board& board)
+{
+    std::string text;
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            text += static_cast<char>('0' + board[row][col]);
+        }
+    }
+    return text;
+}
+
+bool check(const Case& test, PuzzleReader& reader, const char* mode)
+{
+    std::vector<std::string> records;
+    Board board;
+    PuzzleReader::Status status;
+    while ((status = reader.next(board)) != PuzzleReader::Status::end) {
+        records.push_back(status == PuzzleReader::Status::ok ?
+                          digits(board) : "");
+    }
+    if (records == test.records) return true;
+
+    std::cout << "FAIL " << test.name << " (" << mode << "): read "
+              << records.size() << " records\n";
+    for (const std::string& record : records) {
+        std::cout << "    " << (record.empty() ? "bad" : record) << '\n';
+    }
+    return false;
+}
+
+} // namespace
+
+int main()
+{
+    const char* file_name = "reader_test.tmp";
+    int failed = 0;
+    for (const Case& test : cases()) {
+        std::FILE* file = std::fopen(file_name, "wb");
+        if (!file) {
+            std::cout << "Error writing file " << file_name << '\n';
+            return 1;
+        }
+        std::fwrite(test.text.data(), 1, test.text.size(), file);
+        std::fclose(file);
+
+        PuzzleReader mapped;
+        if (!mapped.open(file_name) || !check(test, mapped, "mapped")) {
+            ++failed;
+        }
+
+        file = std::fopen(file_name, "rb");
+        PuzzleReader stream;
+        stream.open(file);
+        if (!check(test, stream, "stream")) ++failed;
+        std::fclose(file);
+    }
+    std::remove(file_name);
+
+    std::cout << (failed == 0 ? "All reader checks passed\n" :
+                                "Some reader checks failed\n");
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,620 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+namespace {
+
+typedef void (*CandidatesKernel)(const unsigned short*, const unsigned char*,
+                                 unsigned short*);
+typedef int (*FewestKernel)(const unsigned short*, const unsigned char*,
+                            unsigned short&);
+typedef bool (*DuplicatesKernel)(const unsigned char*);
+
+struct Kernels {
+    CandidatesKernel candidates;
+    FewestKernel fewest;
+    DuplicatesKernel duplicates;
+    const char* level;
+};
+
+// Candidates of one empty cell, from the unit masks
+inline unsigned short cell_candidates(const unsigned short* units, int cell)
+{
+    int row = cell / 9;
+    int col = cell % 9;
+    int box = (row / 3) * 3 + col / 3;
+    return static_cast<unsigned short>(
+        ~(units[row] | units[9 + col] | units[18 + box]) & 0x1ff);
+}
+
+// ----------------------------------------------------------------------------
+
+void candidates_scalar(const unsigned short* units, const unsigned char* cells,
+                       unsigned short* out)
+{
+    for (int cell = 0; cell < 81; ++cell) {
+        out[cell] = (cells[cell] == 0 ? cell_candidates(units, cell) : 0);
+    }
+}
+
+int fewest_scalar(const unsigned short* units, const unsigned char* cells,
+                  unsigned short& candidates)
+{
+    int best = -1;
+    int best_count = 10;
+    for (int cell = 0; cell < 81; ++cell) {
+        if (cells[cell] != 0) continue;
+
+        unsigned short free = cell_candidates(units, cell);
+        int count = 0;
+        for (unsigned short m = free; m; m &= m - 1) ++count;
+        if (count < best_count) {
+            best = cell;
+            best_count = count;
+            candidates = free;
+        }
+    }
+    return best;
+}
+
+bool duplicates_scalar(const unsigned char* cells)
+{
+    unsigned short seen[27] = {};
+    for (int cell = 0; cell < 81; ++cell) {
+        if (cells[cell] == 0) continue;
+
+        int row = cell / 9;
+        int col = cell % 9;
+        const int units[3] = {row, 9 + col, 18 + (row / 3) * 3 + col / 3};
+        unsigned short bit = static_cast<unsigned short>(
+            1 << (cells[cell] - 1));
+        for (int unit : units) {
+            if (seen[unit] & bit) return true;
+            seen[unit] |= bit;
+        }
+    }
+    return false;
+}
+
+#if SIMD_X86
+
+// Lanes of a row vector that hold cells
+alignas(32) const unsigned short row_lanes[16] = {
+    0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+    0xffff, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Lanes of a 128 bit vector holding the sums of the squares of a band, see
+// duplicates_sse
+alignas(16) const unsigned short box_lanes[8] = {
+    0xffff, 0, 0, 0xffff, 0, 0, 0xffff, 0
+};
+
+// Bits set in each nibble, and the low and high bytes of the mask bit of
+// each number from 0 to 9, for looking up with pshufb
+alignas(16) const unsigned char nibble_counts[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+alignas(16) const unsigned char entry_bits_low[16] = {
+    0, 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(16) const unsigned char entry_bits_high[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0
+};
+
+// ----------------------------------------------------------------------------
+// SSE4.1: each row split into two 128 bit vectors, columns 0 to 7 and
+// column 8
+
+__attribute__((target("sse4.1")))
+inline __m128i popcount16_sse(__m128i v)
+{
+    const __m128i table = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(nibble_counts));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i low = _mm_and_si128(v, nibble);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+    __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(table, low),
+                                 _mm_shuffle_epi8(table, high));
+    return _mm_add_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0xff)),
+                         _mm_srli_epi16(bytes, 8));
+}
+
+__attribute__((target("sse4.1")))
+inline void load_row_sse(const unsigned char* cells, int row, __m128i& low,
+                         __m128i& high)
+{
+    __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(cells + row * 9));
+    low = _mm_cvtepu8_epi16(bytes);
+    high = _mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8));
+}
+
+__attribute__((target("sse4.1")))
+inline void band_boxes_sse(const unsigned short* units, int band,
+                           __m128i& low, __m128i& high)
+{
+    const unsigned short* b = units + 18 + band * 3;
+    low = _mm_setr_epi16(b[0], b[0], b[0], b[1], b[1], b[1], b[2], b[2]);
+    high = _mm_cvtsi32_si128(b[2]);
+}
+
+__attribute__((target("sse4.1")))
+void candidates_sse(const unsigned short* units, const unsigned char* cells,
+                    unsigned short* out)
+{
+    const __m128i all = _mm_set1_epi16(0x1ff);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cols_low = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(units + 9));
+    const __m128i cols_high = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(units + 17));
+
+    for (int band = 0; band < 3; ++band) {
+        __m128i boxes_low, boxes_high;
+        band_boxes_sse(units, band, boxes_low, boxes_high);
+        __m128i used_low = _mm_or_si128(cols_low, boxes_low);
+        __m128i used_high = _mm_or_si128(cols_high, boxes_high);
+        for (int row = band * 3; row < band * 3 + 3; ++row) {
+            __m128i taken = _mm_set1_epi16(units[row]);
+            __m128i cells_low, cells_high;
+            load_row_sse(cells, row, cells_low, cells_high);
+
+            __m128i free_low = _mm_and_si128(
+                _mm_andnot_si128(_mm_or_si128(used_low, taken), all),
+                _mm_cmpeq_epi16(cells_low, zero));
+            __m128i free_high = _mm_and_si128(
+                _mm_andnot_si128(_mm_or_si128(used_high, taken), all),
+                _mm_cmpeq_epi16(cells_high, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + row * 9),
+                             free_low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + row * 9 + 8),
+                             free_high);
+        }
+    }
+}
+
+__attribute__((target("sse4.1")))
+int fewest_sse(const unsigned short* units, const unsigned char* cells,
+               unsigned short& candidates)
+{
+    const __m128i all = _mm_set1_epi16(0x1ff);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i high_lanes = _mm_cvtsi32_si128(0xffff);
+    const __m128i cols_low = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(units + 9));
+    const __m128i cols_high = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(units + 17));
+    const __m128i lane_index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // Each empty cell gets the key (count << 8) | cell, so the smallest key
+    // is the first cell with the fewest candidates. Other lanes get 0xffff.
+    __m128i best = ones;
+    for (int band = 0; band < 3; ++band) {
+        __m128i boxes_low, boxes_high;
+        band_boxes_sse(units, band, boxes_low, boxes_high);
+        __m128i used_low = _mm_or_si128(cols_low, boxes_low);
+        __m128i used_high = _mm_or_si128(cols_high, boxes_high);
+        for (int row = band * 3; row < band * 3 + 3; ++row) {
+            __m128i taken = _mm_set1_epi16(units[row]);
+            __m128i cells_low, cells_high;
+            load_row_sse(cells, row, cells_low, cells_high);
+            __m128i cell = _mm_add_epi16(lane_index,
+                                         _mm_set1_epi16(row * 9));
+
+            __m128i free = _mm_andnot_si128(_mm_or_si128(used_low, taken),
+                                            all);
+            __m128i key = _mm_or_si128(
+                _mm_slli_epi16(popcount16_sse(free), 8), cell);
+            key = _mm_or_si128(key, _mm_andnot_si128(
+                _mm_cmpeq_epi16(cells_low, zero), ones));
+            best = _mm_min_epu16(best, key);
+
+            free = _mm_andnot_si128(_mm_or_si128(used_high, taken), all);
+            key = _mm_or_si128(_mm_slli_epi16(popcount16_sse(free), 8),
+                               _mm_add_epi16(cell, _mm_set1_epi16(8)));
+            __m128i empty = _mm_and_si128(_mm_cmpeq_epi16(cells_high, zero),
+                                          high_lanes);
+            key = _mm_or_si128(key, _mm_andnot_si128(empty, ones));
+            best = _mm_min_epu16(best, key);
+        }
+    }
+
+    int key = _mm_cvtsi128_si32(_mm_minpos_epu16(best)) & 0xffff;
+    if (key == 0xffff) {
+        return -1;
+    }
+    int cell = key & 0xff;
+    candidates = cell_candidates(units, cell);
+    return cell;
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i lane_sums_sse(const __m128i* v)
+{
+    __m128i a = _mm_hadd_epi16(v[0], v[1]);
+    __m128i b = _mm_hadd_epi16(v[2], v[3]);
+    __m128i c = _mm_hadd_epi16(v[4], v[5]);
+    __m128i d = _mm_hadd_epi16(v[6], v[7]);
+    return _mm_hadd_epi16(_mm_hadd_epi16(a, b), _mm_hadd_epi16(c, d));
+}
+
+__attribute__((target("sse4.1")))
+inline bool clash_sse(__m128i sums, __m128i counts, __m128i mask)
+{
+    __m128i equal = _mm_cmpeq_epi16(popcount16_sse(sums), counts);
+    return !_mm_testc_si128(equal, mask);
+}
+
+__attribute__((target("sse4.1")))
+bool duplicates_sse(const unsigned char* cells)
+{
+    // A unit holds no number twice exactly when adding up the mask bits of
+    // its numbers carries nowhere, that is when the sum has as many bits set
+    // as the unit has numbers
+    const __m128i low_table = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(entry_bits_low));
+    const __m128i high_table = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(entry_bits_high));
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i high_lanes = _mm_cvtsi32_si128(0xffff);
+
+    // Columns 0 to 7, and column 8 in the first lane of a second vector
+    __m128i bits[9], filled[9], bits_high[9], filled_high[9];
+    for (int row = 0; row < 9; ++row) {
+        __m128i entries = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(cells + row * 9));
+        __m128i low = _mm_shuffle_epi8(low_table, entries);
+        __m128i high = _mm_shuffle_epi8(high_table, entries);
+        __m128i entry_bits = _mm_or_si128(
+            _mm_cvtepu8_epi16(low),
+            _mm_slli_epi16(_mm_cvtepu8_epi16(high), 8));
+        __m128i entry_bits_8 = _mm_or_si128(
+            _mm_cvtepu8_epi16(_mm_srli_si128(low, 8)),
+            _mm_slli_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(high, 8)), 8));
+
+        bits[row] = entry_bits;
+        bits_high[row] = _mm_and_si128(entry_bits_8, high_lanes);
+        filled[row] = _mm_min_epu16(_mm_cvtepu8_epi16(entries), one);
+        filled_high[row] = _mm_and_si128(_mm_min_epu16(
+            _mm_cvtepu8_epi16(_mm_srli_si128(entries, 8)), one), high_lanes);
+    }
+
+    __m128i col_sums = _mm_setzero_si128(), col_counts = col_sums;
+    __m128i col_sums_8 = col_sums, col_counts_8 = col_sums;
+    for (int row = 0; row < 9; ++row) {
+        col_sums = _mm_add_epi16(col_sums, bits[row]);
+        col_counts = _mm_add_epi16(col_counts, filled[row]);
+        col_sums_8 = _mm_add_epi16(col_sums_8, bits_high[row]);
+        col_counts_8 = _mm_add_epi16(col_counts_8, filled_high[row]);
+    }
+    if (clash_sse(col_sums, col_counts, ones) ||
+        clash_sse(col_sums_8, col_counts_8, high_lanes)) {
+        return true;
+    }
+
+    __m128i row_sums = _mm_add_epi16(lane_sums_sse(bits),
+                                     lane_sums_sse(bits_high));
+    __m128i row_counts = _mm_add_epi16(lane_sums_sse(filled),
+                                       lane_sums_sse(filled_high));
+    if (clash_sse(row_sums, row_counts, ones)) return true;
+
+    __m128i last_sum = _mm_add_epi16(bits[8], bits_high[8]);
+    __m128i last_count = _mm_add_epi16(filled[8], filled_high[8]);
+    for (int i = 0; i < 3; ++i) {
+        last_sum = _mm_hadd_epi16(last_sum, last_sum);
+        last_count = _mm_hadd_epi16(last_count, last_count);
+    }
+    if (clash_sse(last_sum, last_count, high_lanes)) return true;
+
+    const __m128i box_mask = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(box_lanes));
+    for (int band = 0; band < 3; ++band) {
+        int top = band * 3;
+        __m128i groups[2] = {
+            _mm_add_epi16(_mm_add_epi16(bits[top], bits[top + 1]),
+                          bits[top + 2]),
+            _mm_add_epi16(_mm_add_epi16(filled[top], filled[top + 1]),
+                          filled[top + 2])
+        };
+        __m128i lasts[2] = {
+            _mm_add_epi16(_mm_add_epi16(bits_high[top], bits_high[top + 1]),
+                          bits_high[top + 2]),
+            _mm_add_epi16(_mm_add_epi16(filled_high[top],
+                                        filled_high[top + 1]),
+                          filled_high[top + 2])
+        };
+        for (int k = 0; k < 2; ++k) {
+            __m128i g = groups[k];
+            g = _mm_add_epi16(_mm_add_epi16(g, _mm_srli_si128(g, 2)),
+                              _mm_srli_si128(g, 4));
+            groups[k] = _mm_add_epi16(g, _mm_slli_si128(lasts[k], 12));
+        }
+        if (clash_sse(groups[0], groups[1], box_mask)) return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// AVX2: one 256 bit vector per row
+
+__attribute__((target("avx2")))
+inline __m256i popcount16_avx2(__m256i v)
+{
+    const __m256i table = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(nibble_counts)));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, nibble);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, low),
+                                    _mm256_shuffle_epi8(table, high));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xff)),
+                            _mm256_srli_epi16(bytes, 8));
+}
+
+// Loads a row of cells, zero extended to 16 bits a lane
+__attribute__((target("avx2")))
+inline __m256i load_row_avx2(const unsigned char* cells, int row)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(cells + row * 9)));
+}
+
+// Masks of the squares over each column of a band
+__attribute__((target("avx2")))
+inline __m256i band_boxes_avx2(const unsigned short* units, int band)
+{
+    const unsigned short* b = units + 18 + band * 3;
+    return _mm256_setr_epi16(b[0], b[0], b[0], b[1], b[1], b[1],
+                             b[2], b[2], b[2], 0, 0, 0, 0, 0, 0, 0);
+}
+
+__attribute__((target("avx2")))
+void candidates_avx2(const unsigned short* units, const unsigned char* cells,
+                     unsigned short* out)
+{
+    const __m256i all = _mm256_set1_epi16(0x1ff);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cols = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(units + 9));
+
+    for (int band = 0; band < 3; ++band) {
+        __m256i used = _mm256_or_si256(cols, band_boxes_avx2(units, band));
+        for (int row = band * 3; row < band * 3 + 3; ++row) {
+            __m256i taken = _mm256_or_si256(used,
+                                            _mm256_set1_epi16(units[row]));
+            __m256i empty = _mm256_cmpeq_epi16(load_row_avx2(cells, row),
+                                               zero);
+            __m256i free = _mm256_and_si256(_mm256_andnot_si256(taken, all),
+                                            empty);
+            // Rows are stored in order, so the unused lanes of one row are
+            // overwritten by the next
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + row * 9),
+                                free);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+int fewest_avx2(const unsigned short* units, const unsigned char* cells,
+                unsigned short& candidates)
+{
+    const __m256i all = _mm256_set1_epi16(0x1ff);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lanes = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(row_lanes));
+    const __m256i cols = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(units + 9));
+    const __m256i lane_index = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8,
+                                                 9, 10, 11, 12, 13, 14, 15);
+
+    // Keys as in fewest_sse
+    __m256i best = _mm256_set1_epi16(-1);
+    for (int band = 0; band < 3; ++band) {
+        __m256i used = _mm256_or_si256(cols, band_boxes_avx2(units, band));
+        for (int row = band * 3; row < band * 3 + 3; ++row) {
+            __m256i taken = _mm256_or_si256(used,
+                                            _mm256_set1_epi16(units[row]));
+            __m256i free = _mm256_andnot_si256(taken, all);
+            __m256i empty = _mm256_and_si256(
+                _mm256_cmpeq_epi16(load_row_avx2(cells, row), zero), lanes);
+
+            __m256i cell = _mm256_add_epi16(lane_index,
+                                            _mm256_set1_epi16(row * 9));
+            __m256i key = _mm256_or_si256(
+                _mm256_slli_epi16(popcount16_avx2(free), 8), cell);
+            key = _mm256_or_si256(key, _mm256_andnot_si256(
+                empty, _mm256_set1_epi16(-1)));
+            best = _mm256_min_epu16(best, key);
+        }
+    }
+
+    __m128i half = _mm_min_epu16(_mm256_castsi256_si128(best),
+                                 _mm256_extracti128_si256(best, 1));
+    int key = _mm_cvtsi128_si32(_mm_minpos_epu16(half)) & 0xffff;
+    if (key == 0xffff) {
+        return -1;
+    }
+    int cell = key & 0xff;
+    candidates = cell_candidates(units, cell);
+    return cell;
+}
+
+// Adds up the lanes of each of 8 vectors, each sum landing in the lane of
+// its vector's index, within each 128 bit half
+__attribute__((target("avx2")))
+inline __m256i lane_sums_avx2(const __m256i* v)
+{
+    __m256i a = _mm256_hadd_epi16(v[0], v[1]);
+    __m256i b = _mm256_hadd_epi16(v[2], v[3]);
+    __m256i c = _mm256_hadd_epi16(v[4], v[5]);
+    __m256i d = _mm256_hadd_epi16(v[6], v[7]);
+    return _mm256_hadd_epi16(_mm256_hadd_epi16(a, b),
+                             _mm256_hadd_epi16(c, d));
+}
+
+// Whether popcount(sums) differs from counts in any lane of mask
+__attribute__((target("avx2")))
+inline bool clash_avx2(__m256i sums, __m256i counts, __m256i mask)
+{
+    __m256i equal = _mm256_cmpeq_epi16(popcount16_avx2(sums), counts);
+    return !_mm256_testc_si256(equal, mask);
+}
+
+__attribute__((target("avx2")))
+bool duplicates_avx2(const unsigned char* cells)
+{
+    // See duplicates_sse
+    const __m128i low_table = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(entry_bits_low));
+    const __m128i high_table = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(entry_bits_high));
+    const __m256i lanes = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(row_lanes));
+    const __m256i one = _mm256_set1_epi16(1);
+
+    __m256i bits[9], filled[9];
+    for (int row = 0; row < 9; ++row) {
+        __m128i entries = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(cells + row * 9));
+        __m256i low = _mm256_cvtepu8_epi16(
+            _mm_shuffle_epi8(low_table, entries));
+        __m256i high = _mm256_cvtepu8_epi16(
+            _mm_shuffle_epi8(high_table, entries));
+        bits[row] = _mm256_and_si256(
+            _mm256_or_si256(low, _mm256_slli_epi16(high, 8)), lanes);
+        filled[row] = _mm256_and_si256(
+            _mm256_min_epu16(_mm256_cvtepu8_epi16(entries), one), lanes);
+    }
+
+    // Columns add up lane by lane
+    __m256i col_sums = _mm256_setzero_si256();
+    __m256i col_counts = _mm256_setzero_si256();
+    for (int row = 0; row < 9; ++row) {
+        col_sums = _mm256_add_epi16(col_sums, bits[row]);
+        col_counts = _mm256_add_epi16(col_counts, filled[row]);
+    }
+    if (clash_avx2(col_sums, col_counts, lanes)) return true;
+
+    // Rows 0 to 7 add up across lanes, the two halves of the result holding
+    // the sums of columns 0 to 7 and of column 8
+    __m256i sums = lane_sums_avx2(bits);
+    __m256i counts = lane_sums_avx2(filled);
+    __m128i row_sums = _mm_add_epi16(_mm256_castsi256_si128(sums),
+                                     _mm256_extracti128_si256(sums, 1));
+    __m128i row_counts = _mm_add_epi16(_mm256_castsi256_si128(counts),
+                                       _mm256_extracti128_si256(counts, 1));
+    __m256i last_sum = bits[8], last_count = filled[8];
+    for (int i = 0; i < 3; ++i) {
+        last_sum = _mm256_hadd_epi16(last_sum, last_sum);
+        last_count = _mm256_hadd_epi16(last_count, last_count);
+    }
+    // Row 8 goes in lane 8, the first of the top half
+    __m256i all_sums = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(row_sums),
+        _mm_add_epi16(_mm256_castsi256_si128(last_sum),
+                      _mm256_extracti128_si256(last_sum, 1)), 1);
+    __m256i all_counts = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(row_counts),
+        _mm_add_epi16(_mm256_castsi256_si128(last_count),
+                      _mm256_extracti128_si256(last_count, 1)), 1);
+    if (clash_avx2(all_sums, all_counts, lanes)) return true;
+
+    // Squares add up the rows of a band, then groups of three lanes. Lane 8
+    // is alone in the top half, and is moved under lane 6.
+    const __m128i box_mask = _mm_load_si128(
+        reinterpret_cast<const __m128i*>(box_lanes));
+    for (int band = 0; band < 3; ++band) {
+        __m256i band_sum = _mm256_add_epi16(_mm256_add_epi16(
+            bits[band * 3], bits[band * 3 + 1]), bits[band * 3 + 2]);
+        __m256i band_count = _mm256_add_epi16(_mm256_add_epi16(
+            filled[band * 3], filled[band * 3 + 1]), filled[band * 3 + 2]);
+
+        __m256i groups[2] = {band_sum, band_count};
+        __m128i boxes[2];
+        for (int k = 0; k < 2; ++k) {
+            __m256i g = groups[k];
+            g = _mm256_add_epi16(_mm256_add_epi16(g, _mm256_srli_si256(g, 2)),
+                                 _mm256_srli_si256(g, 4));
+            boxes[k] = _mm_add_epi16(_mm256_castsi256_si128(g),
+                _mm_slli_si128(_mm256_extracti128_si256(g, 1), 12));
+        }
+        if (clash_sse(boxes[0], boxes[1], box_mask)) return true;
+    }
+    return false;
+}
+
+#endif // SIMD_X86
+
+// ----------------------------------------------------------------------------
+
+Kernels choose_kernels()
+{
+    const Kernels scalar = {candidates_scalar, fewest_scalar,
+                            duplicates_scalar, "scalar"};
+    const char* forced = std::getenv("SUDOKU_SIMD");
+    if (forced && std::strcmp(forced, "scalar") == 0) {
+        return scalar;
+    }
+
+#if SIMD_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse = __builtin_cpu_supports("sse4.1");
+    if (forced && std::strcmp(forced, "sse4.1") == 0) {
+        avx2 = false;
+    }
+    if (avx2) {
+        const Kernels kernels = {candidates_avx2, fewest_avx2,
+                                 duplicates_avx2, "avx2"};
+        return kernels;
+    }
+    if (sse) {
+        const Kernels kernels = {candidates_sse, fewest_sse, duplicates_sse,
+                                 "sse4.1"};
+        return kernels;
+    }
+#endif
+    return scalar;
+}
+
+const Kernels& kernels()
+{
+    static const Kernels chosen = choose_kernels();
+    return chosen;
+}
+
+} // namespace
+
+void simd_candidates(const unsigned short* units, const unsigned char* cells,
+                     unsigned short* out)
+{
+    kernels().candidates(units, cells, out);
+}
+
+int simd_fewest_candidates(const unsigned short* units,
+                           const unsigned char* cells,
+                           unsigned short& candidates)
+{
+    return kernels().fewest(units, cells, candidates);
+}
+
+bool simd_duplicates(const unsigned char* cells)
+{
+    return kernels().duplicates(cells);
+}
+
+const char* simd_level()
+{
+    return kernels().level;
+}
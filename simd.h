@@ -0,0 +1,38 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * Vector kernels for the 9 by 9 board. AVX2 and SSE4.1 versions are chosen
+ * at run time from what the processor supports, with a scalar version used
+ * everywhere else (the SUDOKU_SIMD environment variable can force "avx2",
+ * "sse4.1" or "scalar", for comparing them).
+ *
+ * Each row of the board is one vector of 16 lanes, of which the first 9
+ * are used. Cells are passed one byte each, as row*9+col with 0 for
+ * unfilled squares, in a buffer of at least simd_buffer_size bytes so that
+ * every row can be loaded whole. Unit masks are the 27 occupancy masks of
+ * the board, rows then columns then squares, with bit (entry-1) set when
+ * entry is present.
+ */
+
+constexpr int simd_buffer_size = 96;
+
+// Writes the candidates of every cell to out, 0 for filled cells. out needs
+// room for simd_buffer_size masks, as whole rows are stored at once.
+void simd_candidates(const unsigned short* units, const unsigned char* cells,
+                     unsigned short* out);
+
+// Finds the empty cell with the fewest candidates, the first one in
+// row-major order on ties, and stores its candidates. Returns -1 if every
+// cell is filled.
+int simd_fewest_candidates(const unsigned short* units,
+                           const unsigned char* cells,
+                           unsigned short& candidates);
+
+// Whether any number appears twice in a row, column, or square
+bool simd_duplicates(const unsigned char* cells);
+
+// Instruction set the kernels run on: "avx2", "sse4.1" or "scalar"
+const char* simd_level();
+
+#endif // SIMD_H
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <climits>
+
+#include "solution_cache.h"
+
+SolutionCache::SolutionCache(std::size_t capacity)
+    : m_capacity(capacity), m_hits(0), m_misses(0)
+{
+    m_index.reserve(capacity);
+}
+
+bool SolutionCache::find(const Board& puzzle, unsigned long int limit,
+                         CanonicalForm& form, Board& solution,
+                         unsigned long int& solutions)
+{
+    // Canonicalising is the slow part, so it happens outside the lock
+    if (!form.compute(puzzle)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_misses++;
+        return false;
+    }
+    if (limit == 0) limit = ULONG_MAX;
+
+    CanonicalForm::Key key;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(form.hash());
+
+        // An entry answers if it searched as far, or found every solution
+        // there is
+        if (it == m_index.end() || it->second->key != form.key() ||
+                (it->second->limit < limit &&
+                 it->second->solutions >= it->second->limit)) {
+            m_misses++;
+            return false;
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        const Entry& entry = m_entries.front();
+        key = entry.solution;
+        solutions = std::min(entry.solutions, limit);
+        m_hits++;
+    }
+
+    if (solutions > 0) {
+        form.from_canonical(key, solution);
+    }
+    return true;
+}
+
+void SolutionCache::insert(const CanonicalForm& form, unsigned long int limit,
+                           const Board& solution,
+                           unsigned long int solutions)
+{
+    if (!form.valid() || m_capacity == 0) return;
+    if (limit == 0) limit = ULONG_MAX;
+
+    Entry entry;
+    entry.key = form.key();
+    entry.hash = form.hash();
+    entry.limit = limit;
+    entry.solutions = solutions;
+    if (solutions > 0) {
+        form.to_canonical(solution, entry.solution);
+    } else {
+        entry.solution.fill('0');
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(form.hash());
+    if (it != m_index.end()) {
+        // Replaces an entry searched less far, or one whose key only shares
+        // its hash
+        Entry& old = *it->second;
+        if (old.key != entry.key || old.limit < entry.limit) {
+            old = entry;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().hash);
+        m_entries.pop_back();
+    }
+    m_entries.push_front(entry);
+    m_index.emplace(form.hash(), m_entries.begin());
+}
+
+unsigned long long int SolutionCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+unsigned long long int SolutionCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+double SolutionCache::hit_rate() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unsigned long long int lookups = m_hits + m_misses;
+    return lookups > 0 ? static_cast<double>(m_hits) / lookups : 0;
+}
+
+std::size_t SolutionCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+std::size_t SolutionCache::memory() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // A list node holds an entry and two links, and an index node a key, a
+    // value, a link and the cached hash
+    const std::size_t list_node = sizeof(Entry) + 2 * sizeof(void*);
+    const std::size_t index_node =
+        sizeof(std::pair<const std::uint64_t, Entries::iterator>) +
+        2 * sizeof(void*);
+    return m_entries.size() * (list_node + index_node) +
+           m_index.bucket_count() * sizeof(void*);
+}
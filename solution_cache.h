@@ -0,0 +1,72 @@
+#ifndef SOLUTION_CACHE_H
+#define SOLUTION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "canonical.h"
+#include "sudoku.h"
+
+/*
+ * Least recently used cache of solved 9 by 9 puzzles, keyed by canonical
+ * form (see canonical.h), so that a puzzle equivalent to one solved before
+ * is answered without searching. Solutions are kept in the canonical
+ * orientation and mapped back to each caller's. Safe to share between
+ * threads.
+ */
+
+class SolutionCache {
+public:
+    // Keeps at most capacity puzzles
+    explicit SolutionCache(std::size_t capacity = 1 << 16);
+
+    SolutionCache(const SolutionCache&) = delete;
+    SolutionCache& operator=(const SolutionCache&) = delete;
+
+    // Looks for a puzzle equivalent to puzzle, searched for at least limit
+    // solutions (0 meaning all of them). form is given the canonical form
+    // of puzzle, for insert(). On a hit, writes the first solution into
+    // solution (which may be puzzle itself) and the number found into
+    // solutions, and returns true.
+    bool find(const Board& puzzle, unsigned long int limit,
+              CanonicalForm& form, Board& solution,
+              unsigned long int& solutions);
+
+    // Remembers the outcome of searching the puzzle whose canonical form is
+    // form for limit solutions. Ignored if the form is not valid.
+    void insert(const CanonicalForm& form, unsigned long int limit,
+                const Board& solution, unsigned long int solutions);
+
+    unsigned long long int hits() const;
+    unsigned long long int misses() const;
+    // Fraction of lookups answered from the cache
+    double hit_rate() const;
+
+    // Number of puzzles held, and roughly how many bytes they take
+    std::size_t size() const;
+    std::size_t memory() const;
+private:
+    struct Entry {
+        CanonicalForm::Key key;
+        std::uint64_t hash;
+        CanonicalForm::Key solution;
+        unsigned long int limit;
+        unsigned long int solutions;
+    };
+    typedef std::list<Entry> Entries;
+
+    std::size_t m_capacity;
+
+    // Most recently used first, with an index by hash of the key
+    Entries m_entries;
+    std::unordered_map<std::uint64_t, Entries::iterator> m_index;
+
+    unsigned long long int m_hits;
+    unsigned long long int m_misses;
+    mutable std::mutex m_mutex;
+};
+
+#endif // SOLUTION_CACHE_H
@@ -0,0 +1,223 @@
+#include <QRunnable>
+
+#include "solve_service.h"
+
+constexpr std::size_t SolveService::kept_jobs;
+
+class SolveService::Runnable : public QRunnable {
+public:
+    Runnable(SolveService* service, int id) : m_service(service), m_id(id) {}
+
+    void run() override { m_service->run(m_id); }
+private:
+    SolveService* m_service;
+    int m_id;
+};
+
+SolveService::SolveService(QObject* parent)
+    : QObject(parent), m_next_id(1), m_cache(1 << 12)
+{}
+
+SolveService::~SolveService()
+{
+    cancel_all();
+    m_pool.waitForDone();
+}
+
+int SolveService::submit(const AnyBoard& puzzle, const QString& source)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->puzzle = puzzle;
+    job->board = puzzle;
+    job->status.source = source;
+    job->status.state = State::queued;
+    job->status.result = AnyBoard::Result::solved;
+    job->status.elapsed = SolveStats::Clock::duration::zero();
+    job->status.solutions = 0;
+    job->status.cached = false;
+
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& entry : m_jobs) {
+            Job& old = *entry.second;
+            if (old.status.source == source &&
+                    (old.status.state == State::queued ||
+                     old.status.state == State::running)) {
+                old.status.state = State::superseded;
+                old.board.cancel();
+            }
+        }
+
+        id = m_next_id++;
+        job->status.id = id;
+        m_jobs.emplace(id, job);
+        forget_old_jobs();
+    }
+
+    m_pool.start(new Runnable(this, id));
+    return id;
+}
+
+void SolveService::cancel(int id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) return;
+
+    Job& job = *it->second;
+    if (job.status.state == State::queued ||
+            job.status.state == State::running) {
+        job.status.state = State::cancelled;
+        job.board.cancel();
+    }
+}
+
+void SolveService::cancel_all()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_jobs) {
+        Job& job = *entry.second;
+        if (job.status.state == State::queued ||
+                job.status.state == State::running) {
+            job.status.state = State::cancelled;
+            job.board.cancel();
+        }
+    }
+}
+
+std::vector<SolveService::Status> SolveService::jobs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Status> statuses;
+    statuses.reserve(m_jobs.size());
+    for (const auto& entry : m_jobs) {
+        statuses.push_back(entry.second->status);
+    }
+    return statuses;
+}
+
+bool SolveService::result(int id, Status& status, AnyBoard& puzzle,
+                          AnyBoard& solution) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end() || it->second->status.state != State::finished) {
+        return false;
+    }
+
+    status = it->second->status;
+    puzzle = it->second->puzzle;
+    solution = it->second->board;
+    return true;
+}
+
+int SolveService::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int count = 0;
+    for (const auto& entry : m_jobs) {
+        State state = entry.second->status.state;
+        if (state == State::queued || state == State::running) count++;
+    }
+    return count;
+}
+
+void SolveService::run(int id)
+{
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_jobs.find(id);
+        if (it == m_jobs.end()) return;
+
+        job = it->second;
+        if (job->status.state != State::queued) {
+            // Cancelled or superseded before it started
+            emit finished(id);
+            return;
+        }
+        job->status.state = State::running;
+    }
+
+    auto begin_time = SolveStats::Clock::now();
+    AnyBoard& board = job->board;
+    board.set_collect_stats(true);
+
+    // 9 by 9 puzzles equivalent to one solved before are answered from the
+    // cache
+    Board puzzle;
+    CanonicalForm form;
+    unsigned long int solutions = 0;
+    bool cached = false;
+    if (board.box() == 3) {
+        for (int row = 0; row < 9; ++row) {
+            for (int col = 0; col < 9; ++col) {
+                puzzle[row][col] = board.at(row, col);
+            }
+        }
+        cached = m_cache.find(puzzle, 2, form, puzzle, solutions);
+    }
+
+    // Looking for a second solution tells whether the first is unique
+    if (cached) {
+        for (int row = 0; row < 9; ++row) {
+            for (int col = 0; col < 9; ++col) {
+                board.set(row, col, puzzle[row][col]);
+            }
+        }
+    } else if (board.backend() == AnyBoard::Backend::dancing_links) {
+        solutions = board.count_solutions(2);
+    } else {
+        solutions = board.count_solutions(2, m_search_pool);
+    }
+
+    if (!cached && form.valid() &&
+            board.result() != AnyBoard::Result::cancelled &&
+            board.result() != AnyBoard::Result::budget_exceeded) {
+        for (int row = 0; row < 9; ++row) {
+            for (int col = 0; col < 9; ++col) {
+                puzzle[row][col] = board.at(row, col);
+            }
+        }
+        m_cache.insert(form, 2, puzzle, solutions);
+    }
+
+    auto end_time = SolveStats::Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Cancelled or superseded jobs keep that state, and their result
+        // is dropped
+        if (job->status.state == State::running) {
+            job->status.state = State::finished;
+            job->status.result = cached ? AnyBoard::Result::solved :
+                                          board.result();
+            job->status.elapsed = end_time - begin_time;
+            job->status.solutions = solutions;
+            job->status.cached = cached;
+            if (!cached) job->status.stats = board.stats();
+        }
+        forget_old_jobs();
+    }
+    emit finished(id);
+}
+
+void SolveService::forget_old_jobs()
+{
+    std::size_t done = 0;
+    for (const auto& entry : m_jobs) {
+        State state = entry.second->status.state;
+        if (state != State::queued && state != State::running) done++;
+    }
+
+    for (auto it = m_jobs.begin(); done > kept_jobs && it != m_jobs.end();) {
+        State state = it->second->status.state;
+        if (state != State::queued && state != State::running) {
+            it = m_jobs.erase(it);
+            done--;
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef SOLVE_SERVICE_H
+#define SOLVE_SERVICE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "any_board.h"
+#include "solution_cache.h"
+#include "thread_pool.h"
+
+/*
+ * Solves boards for the interface, several at once. Each request becomes a
+ * job with its own id, run on a QThreadPool, and finished() reports it
+ * through a queued signal so that results arrive on the GUI thread. A new
+ * request from the same source as one still queued or running supersedes
+ * it: the older search is cancelled and its result dropped.
+ *
+ * Every job looks for a second solution, to tell whether the first is
+ * unique. Backtracking searches split across one shared ThreadPool, which
+ * several searches can use at the same time, and 9 by 9 puzzles equivalent
+ * to one solved before are answered from a shared solution cache.
+ */
+
+class SolveService : public QObject {
+Q_OBJECT
+public:
+    enum class State { queued, running, finished, cancelled, superseded };
+
+    struct Status {
+        int id;
+        // Where the puzzle came from, such as a file name
+        QString source;
+        State state;
+        // Once finished
+        AnyBoard::Result result;
+        // Wall clock time of the whole job, cache lookup included
+        SolveStats::Clock::duration elapsed;
+        unsigned long int solutions;
+        // Whether it was answered from the cache, without searching
+        bool cached;
+        // Of the search, if there was one
+        SolveStats stats;
+    };
+
+    // Finished, cancelled and superseded jobs kept, beyond which the oldest
+    // are forgotten
+    static constexpr std::size_t kept_jobs = 32;
+
+    explicit SolveService(QObject* parent = nullptr);
+    ~SolveService();
+
+    // Queues a solve of puzzle, superseding any job from the same source
+    // that hasn't finished. Returns the new job's id.
+    int submit(const AnyBoard& puzzle, const QString& source);
+    // Cancels a job if it hasn't finished
+    void cancel(int id);
+    void cancel_all();
+
+    // Every job remembered, oldest first
+    std::vector<Status> jobs() const;
+    // The status, puzzle and solution of a finished job. Returns false if
+    // the job hasn't finished or was forgotten.
+    bool result(int id, Status& status, AnyBoard& puzzle,
+                AnyBoard& solution) const;
+
+    // Jobs queued or running
+    int pending() const;
+
+    const SolutionCache& cache() const { return m_cache; }
+signals:
+    // Emitted from the pool thread that ran a job, whether it finished or
+    // was cancelled
+    void finished(int id);
+private:
+    class Runnable;
+
+    struct Job {
+        Status status;
+        AnyBoard puzzle;
+        // Searched by the job's thread, and otherwise only cancelled until
+        // the job finishes
+        AnyBoard board;
+    };
+
+    void run(int id);
+    // Drops the oldest jobs that are done, with the lock held
+    void forget_old_jobs();
+
+    mutable std::mutex m_mutex;
+    std::map<int, std::shared_ptr<Job>> m_jobs;
+    int m_next_id;
+
+    SolutionCache m_cache;
+    ThreadPool m_search_pool;
+    QThreadPool m_pool;
+};
+
+#endif // SOLVE_SERVICE_H
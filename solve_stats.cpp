@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <ostream>
+
+#include "solve_stats.h"
+
+constexpr int TraceWriter::reader_thread;
+
+SolveStats& SolveStats::operator+=(const SolveStats& other)
+{
+    if (other.solves == 0) return *this;
+    if (solves == 0 || other.start < start) start = other.start;
+
+    nodes += other.nodes;
+    backtracks += other.backtracks;
+    max_depth = std::max(max_depth, other.max_depth);
+    propagations += other.propagations;
+    restarts += other.restarts;
+    parse_time += other.parse_time;
+    validate_time += other.validate_time;
+    search_time += other.search_time;
+    solves += other.solves;
+    return *this;
+}
+
+double microseconds(SolveStats::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void write_stats_csv_header(std::ostream& os)
+{
+    os << "name,nodes,backtracks,max_depth,propagations,restarts,parse_us,"
+          "validate_us,search_us,total_us\n";
+}
+
+void write_stats_csv(std::ostream& os, const std::string& name,
+                     const SolveStats& stats)
+{
+    os << name << ',' << stats.nodes << ',' << stats.backtracks << ','
+       << stats.max_depth << ',' << stats.propagations << ','
+       << stats.restarts << ','
+       << microseconds(stats.parse_time) << ','
+       << microseconds(stats.validate_time) << ','
+       << microseconds(stats.search_time) << ','
+       << microseconds(stats.total_time()) << '\n';
+}
+
+// ----------------------------------------------------------------------------
+
+TraceWriter::TraceWriter(std::ostream& os,
+                         SolveStats::Clock::time_point epoch)
+    : m_os(os), m_epoch(epoch), m_closed(false)
+{
+    // The reader's row is named before any events, so each one after
+    // follows a comma
+    m_os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":["
+         << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << reader_thread << ",\"args\":{\"name\":\"reader\"}}";
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+void TraceWriter::write(const std::string& name, const SolveStats& stats,
+                        int thread)
+{
+    event(name, "parse", stats.parse_start, stats.parse_time, reader_thread,
+          nullptr);
+    event(name, "validate", stats.start, stats.validate_time, thread,
+          nullptr);
+    event(name, "search", stats.start + stats.validate_time,
+          stats.search_time, thread, &stats);
+}
+
+void TraceWriter::close()
+{
+    if (m_closed) return;
+    m_os << "\n]}\n";
+    m_os.flush();
+    m_closed = true;
+}
+
+void TraceWriter::event(const std::string& name, const char* phase,
+                        SolveStats::Clock::time_point begin,
+                        SolveStats::Clock::duration duration, int thread,
+                        const SolveStats* args)
+{
+    if (duration == SolveStats::Clock::duration::zero()) return;
+
+    m_os << ",\n";
+
+    // Complete events, with times in microseconds
+    m_os << "{\"name\":\"" << phase << " " << name
+         << "\",\"cat\":\"" << phase
+         << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+         << ",\"ts\":" << microseconds(begin - m_epoch)
+         << ",\"dur\":" << microseconds(duration);
+    if (args) {
+        m_os << ",\"args\":{\"nodes\":" << args->nodes
+             << ",\"backtracks\":" << args->backtracks
+             << ",\"max_depth\":" << args->max_depth
+             << ",\"propagations\":" << args->propagations
+             << ",\"restarts\":" << args->restarts << '}';
+    }
+    m_os << '}';
+}
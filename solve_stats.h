@@ -0,0 +1,103 @@
+#ifndef SOLVE_STATS_H
+#define SOLVE_STATS_H
+
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+/*
+ * What one solve cost, filled in by BasicBoard::count_solutions() when
+ * stats are turned on (see BasicBoard::set_collect_stats()). The counters
+ * are kept by the search either way, as plain increments; only the clock is
+ * left alone while stats are off, so turning them off costs next to
+ * nothing. Stats add up with +=, so one object can also total a whole run.
+ */
+
+struct SolveStats {
+    typedef std::chrono::steady_clock Clock;
+
+    // Search nodes visited, and dead ends backed out of
+    unsigned long int nodes = 0;
+    unsigned long int backtracks = 0;
+    // Deepest level of the search stack reached, where the first branch is
+    // level 1
+    int max_depth = 0;
+    // Numbers placed by propagation (naked and hidden singles)
+    unsigned long int propagations = 0;
+    // Times the search started over (see BasicBoard::set_restart_unit())
+    unsigned long int restarts = 0;
+
+    // Time spent reading the puzzle (recorded by whoever parsed it), loading
+    // and checking the givens, and searching
+    Clock::duration parse_time = Clock::duration::zero();
+    Clock::duration validate_time = Clock::duration::zero();
+    Clock::duration search_time = Clock::duration::zero();
+
+    // When parsing and validation started, for traces. Parsing may have
+    // run well before, on another thread.
+    Clock::time_point parse_start;
+    Clock::time_point start;
+
+    // Solves added together
+    unsigned long int solves = 0;
+
+    Clock::duration total_time() const
+    {
+        return parse_time + validate_time + search_time;
+    }
+
+    void clear() { *this = SolveStats(); }
+
+    // Sums the counters and times, keeping the deepest depth and the
+    // earliest start
+    SolveStats& operator+=(const SolveStats& other);
+};
+
+// Microseconds in a duration, with fractions
+double microseconds(SolveStats::Clock::duration duration);
+
+// Writes stats as comma separated values, one solve per row, the first
+// column naming the solve
+void write_stats_csv_header(std::ostream& os);
+void write_stats_csv(std::ostream& os, const std::string& name,
+                     const SolveStats& stats);
+
+/*
+ * Writes solves as a trace in the Chrome trace event format, which
+ * chrome://tracing and Perfetto load. Each solve becomes one event per
+ * phase, the search carrying its counters as arguments. Validation and
+ * search go on the given thread, and parsing on a row of its own named
+ * "reader", since puzzles are read apart from where they are solved.
+ * Names go into the JSON as they are, so should need no escaping. Times
+ * are measured from the writer's epoch. close() (or the destructor)
+ * finishes the JSON.
+ */
+
+class TraceWriter {
+public:
+    explicit TraceWriter(std::ostream& os,
+                         SolveStats::Clock::time_point epoch =
+                             SolveStats::Clock::now());
+    ~TraceWriter();
+
+    // Thread id of the reader's row
+    static constexpr int reader_thread = -1;
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void write(const std::string& name, const SolveStats& stats,
+               int thread = 0);
+    void close();
+private:
+    void event(const std::string& name, const char* phase,
+               SolveStats::Clock::time_point begin,
+               SolveStats::Clock::duration duration, int thread,
+               const SolveStats* args);
+
+    std::ostream& m_os;
+    SolveStats::Clock::time_point m_epoch;
+    bool m_closed;
+};
+
+#endif // SOLVE_STATS_H
@@ -1,167 +1,1163 @@
+#include <algorithm>
 #include <string>
 #include <sstream>
+#include <istream>
+#include <ostream>
 #include <array>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 #include "sudoku.h"
+#include "dlx.h"
+#include "geometry.h"
+#include "simd.h"
+#include "thread_pool.h"
 
-Board::Board()
-    : m_count(0), m_cancel(false)
+namespace {
+
+// Written at the top of every checkpoint. Version 2 fills the last cells of
+// an enumeration without looking for hidden singles, so a checkpoint of
+// version 1 would resume onto a different search tree.
+constexpr int checkpoint_version = 2;
+
+// Character standing for a number in a cell, '0' for an unfilled one, and
+// letters from 'A' for numbers above 9
+inline char digit_char(int entry)
+{
+    return static_cast<char>(entry < 10 ? '0' + entry : 'A' + entry - 10);
+}
+
+// Number a character stands for, or -1 if it isn't a digit or letter
+inline int digit_value(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'z') return ch - 'a' + 10;
+    return -1;
+}
+
+// Term i, counting from 0, of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, 1,
+// 2, ..., a restart schedule within a constant factor of the best one for
+// any distribution of run times
+unsigned long int luby(unsigned long int i)
+{
+    // Find the complete run 1, 1, 2, ..., 2^power holding term i
+    unsigned long int size = 1;
+    int power = 0;
+    while (size < i + 1) {
+        size = 2 * size + 1;
+        ++power;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) >> 1;
+        --power;
+        i %= size;
+    }
+    return 1ul << power;
+}
+
+} // namespace
+
+template <int Box>
+constexpr typename BasicBoard<Box>::Mask BasicBoard<Box>::all_entries;
+template <int Box>
+constexpr int BasicBoard<Box>::leaf_cells;
+
+template <int Box>
+struct BasicBoard<Box>::SharedSearch {
+    SharedSearch(unsigned long int limit, const AtomicFlag* cancel)
+        : limit(limit), cancel(cancel), stop(false), budget_exceeded(false),
+          progress(0), found(0), nodes(0), count(0), backtracks(0),
+          propagations(0), max_depth(0), pending(0)
+    {}
+
+    const unsigned long int limit;
+    // Cancel flag of the board that started the search
+    const AtomicFlag* cancel;
+    std::atomic<bool> stop;
+
+    // Nodes searched so far, counted in steps of 1024 by every subtree,
+    // for the node budget
+    std::atomic<bool> budget_exceeded;
+    std::atomic<unsigned long int> progress;
+
+    // Guards found and first
+    std::mutex mutex;
+    unsigned long int found;
+    Grid first;
+
+    std::atomic<unsigned long int> nodes;
+    std::atomic<unsigned long int> count;
+    std::atomic<unsigned long int> backtracks;
+    std::atomic<unsigned long int> propagations;
+    // Guarded by mutex
+    int max_depth;
+
+    // Subtrees still being searched
+    std::atomic<long> pending;
+    std::condition_variable done;
+};
+
+template <int Box>
+BasicBoard<Box>::BasicBoard()
+    : m_units(), m_cells(), m_trail(), m_trail_size(0), m_empty_cells(0),
+      m_stack(), m_count(0), m_nodes(0), m_backtracks(0),
+      m_propagations(0), m_max_depth(0), m_root_depth(0), m_restarts(0),
+      m_collect_stats(false), m_found(0), m_limit(1),
+      m_heuristic(Heuristic::first_empty),
+      m_value_order(ValueOrder::ascending), m_seed(0), m_random(0),
+      m_randomize(false), m_restart_unit(0), m_attempt_end(ULONG_MAX),
+      m_restart_due(false), m_backend(Backend::backtracking),
+      m_cancel(false), m_time_budget(0),
+      m_node_budget(0), m_budget_exceeded(false), m_result(Result::unsolvable),
+      m_shared(nullptr), m_enumeration(Enumeration::idle), m_depth(0)
 {
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
+    for (std::size_t row = 0; row < size; ++row) {
+        for (std::size_t col = 0; col < size; ++col) {
             m_grid[row][col] = 0;
         }
     }
 }
 
-Board::Board(const std::array<std::array<int, 9>, 9>& grid)
-    : m_grid(grid), m_count(0), m_cancel(false)
+template <int Box>
+BasicBoard<Box>::BasicBoard(const Grid& grid)
+    : m_grid(grid), m_units(), m_cells(), m_trail(),
+      m_trail_size(0), m_empty_cells(0), m_stack(), m_count(0), m_nodes(0), m_backtracks(0),
+      m_propagations(0), m_max_depth(0), m_root_depth(0), m_restarts(0),
+      m_collect_stats(false), m_found(0), m_limit(1),
+      m_heuristic(Heuristic::first_empty),
+      m_value_order(ValueOrder::ascending), m_seed(0), m_random(0),
+      m_randomize(false), m_restart_unit(0), m_attempt_end(ULONG_MAX),
+      m_restart_due(false), m_backend(Backend::backtracking),
+      m_cancel(false), m_time_budget(0),
+      m_node_budget(0), m_budget_exceeded(false), m_result(Result::unsolvable),
+      m_shared(nullptr), m_enumeration(Enumeration::idle), m_depth(0)
 {}
 
-std::string Board::str() const
+template <int Box>
+std::string BasicBoard<Box>::str() const
 {
+    // Each square is drawn 2*Box+1 characters wide
+    const std::string dashes(2 * Box + 1, '-');
+    std::string border = "+" + dashes;
+    std::string separator = "|" + dashes;
+    for (int i = 1; i < Box; ++i) {
+        border += "-" + dashes;
+        separator += "+" + dashes;
+    }
+    border += "+\n";
+    separator += "|\n";
+
     std::stringstream ss;
 
-    for (std::size_t row = 0; row < 9; ++row) {
-        if (row == 0) ss << "+-----------------------+\n";
+    for (std::size_t row = 0; row < size; ++row) {
+        if (row == 0) ss << border;
 
-        for (std::size_t col = 0; col < 9; ++col) {
+        for (std::size_t col = 0; col < size; ++col) {
             if (col == 0) ss << "| ";
-            ss << m_grid[row][col] << ' ';
-            if (col != 0 && (col+1)%3 == 0) ss << "| ";
+            ss << digit_char(m_grid[row][col]) << ' ';
+            if (col != 0 && (col+1)%Box == 0) ss << "| ";
         }
         ss << '\n';
 
-        if (row != 0 && row != 9-1 && (row+1)%3 == 0) {
-            ss << "|-------+-------+-------|\n";
+        if (row != 0 && row != size-1 && (row+1)%Box == 0) {
+            ss << separator;
         }
-        if (row == 9-1) ss << "+-----------------------+\n";
+        if (row == size-1) ss << border;
     }
 
     return ss.str();
 }
 
-bool Board::solve()
+template <int Box>
+bool BasicBoard<Box>::solve()
 {
-    if (m_cancel) {
+    if (m_cancel.get()) {
+        m_result = Result::cancelled;
         return true;
     }
+    return count_solutions(1) > 0 || m_cancel.get();
+}
 
-    m_count = 0;
-    if (contradictory()) {
-        return false;
+template <int Box>
+unsigned long int BasicBoard<Box>::count_solutions(unsigned long int limit)
+{
+    begin_search();
+    m_limit = (limit == 0 ? ULONG_MAX : limit);
+    bool loaded = !m_cancel.get() && load_grid();
+    end_validation();
+    if (!loaded) {
+        end_search();
+        return 0;
     }
-    return solve(m_grid);
+
+    if (m_backend == Backend::dancing_links) {
+        // The node pool is built once per thread and reused by every solve
+        static thread_local BasicDlx<Box> dlx;
+        dlx.set_cancel_flag(&m_cancel.atomic());
+        dlx.set_budget(m_node_budget, m_deadline);
+
+        Grid solution;
+        m_found = dlx.solve(m_grid, solution, limit);
+        m_budget_exceeded = dlx.budget_exceeded();
+        dlx.set_cancel_flag(nullptr);
+
+        m_nodes = dlx.nodes();
+        m_count = dlx.count();
+        if (m_found > 0) {
+            m_grid = solution;
+        }
+    } else if (m_restart_unit > 0) {
+        search_with_restarts();
+    } else {
+        search();
+    }
+    end_search();
+    return m_found;
 }
 
-bool Board::contradictory()
+template <int Box>
+bool BasicBoard<Box>::solve(ThreadPool& pool)
 {
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
-            if (m_grid[row][col] != 0 &&
-                    !valid(m_grid, row, col, m_grid[row][col])) {
-                return true;
+    if (m_cancel.get()) {
+        m_result = Result::cancelled;
+        return true;
+    }
+    return count_solutions(1, pool) > 0 || m_cancel.get();
+}
+
+template <int Box>
+unsigned long int BasicBoard<Box>::count_solutions(unsigned long int limit,
+                                                   ThreadPool& pool)
+{
+    begin_search();
+    m_limit = (limit == 0 ? ULONG_MAX : limit);
+    bool loaded = !m_cancel.get() && load_grid();
+    end_validation();
+    if (!loaded) {
+        end_search();
+        return 0;
+    }
+
+    SharedSearch shared(m_limit, &m_cancel);
+    const bool fewest = (m_heuristic == Heuristic::fewest_candidates);
+
+    // The root is entered in place first, as the sequential search would,
+    // so that a puzzle singles alone solve is never split at all
+    m_nodes++;
+    if (fewest && !propagate()) {
+        end_search();
+        return 0;
+    }
+    if (m_trail_size == m_empty_cells) {
+        record_solution();
+        end_search();
+        return m_found;
+    }
+
+    // Frontier nodes count against the budgets as the subtrees' nodes do
+    auto out_of_budget = [this, &shared] {
+        if ((m_node_budget > 0 && ++shared.progress >= m_node_budget) ||
+                (m_time_budget.count() > 0 &&
+                 std::chrono::steady_clock::now() >= m_deadline)) {
+            shared.budget_exceeded = true;
+            shared.stop = true;
+        }
+        return shared.stop.load();
+    };
+
+    // Expand the top of the tree breadth first until there are enough
+    // subtrees to keep every worker busy, even if some finish early. Every
+    // child is entered as it is made, propagating in fewest_candidates
+    // mode, so that dead ends and solutions never become subtrees. Counts
+    // are kept on this board, and a node is counted once: when it is
+    // expanded, dropped, left over at a stop, or entered by its subtree's
+    // search.
+    const std::size_t target = static_cast<std::size_t>(pool.size()) * 16;
+    std::deque<BasicBoard> frontier(1, *this);
+    BasicBoard& root = frontier.front();
+    root.m_shared = &shared;
+    root.m_nodes = root.m_count = root.m_propagations = 0;
+    while (!frontier.empty() && frontier.size() < target &&
+           !m_cancel.get() && !shared.stop) {
+        BasicBoard& parent = frontier.front();
+        if (parent.m_root_depth > 0) m_nodes++;
+
+        // Every board in the frontier has an empty cell left
+        int cell;
+        Mask candidates = 0;
+        parent.branch_cell(cell, candidates);
+
+        while (candidates && !out_of_budget()) {
+            int entry = parent.take_entry(candidates);
+            m_count++;
+
+            frontier.push_back(parent);
+            BasicBoard& child = frontier.back();
+            child.make(cell, entry);
+            child.m_root_depth = parent.m_root_depth + 1;
+
+            bool alive = (!fewest || child.propagate());
+            m_count += child.m_count;
+            m_propagations += child.m_propagations;
+            child.m_count = child.m_propagations = 0;
+            if (alive && child.m_trail_size == child.m_empty_cells) {
+                child.record_solution();
+                alive = false;
+            }
+            if (!alive) {
+                m_nodes++;
+                frontier.pop_back();
             }
         }
+        frontier.pop_front();
+    }
+    if (m_cancel.get() || shared.stop) {
+        m_nodes += frontier.size();
+        frontier.clear();
+    }
+
+    // Search the subtrees. Tasks are pushed in order, so with the pool's
+    // stealing the leftmost subtrees tend to run first.
+    std::vector<BasicBoard> subtrees(frontier.begin(), frontier.end());
+    shared.pending = static_cast<long>(subtrees.size());
+    for (BasicBoard& subtree : subtrees) {
+        pool.submit([&subtree, &shared](int) {
+            subtree.search();
+            shared.nodes += subtree.m_nodes;
+            shared.count += subtree.m_count;
+            shared.backtracks += subtree.m_backtracks;
+            shared.propagations += subtree.m_propagations;
+            {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                shared.max_depth =
+                    std::max(shared.max_depth,
+                             subtree.m_root_depth + subtree.m_max_depth);
+            }
+
+            if (--shared.pending == 0) {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                shared.done.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(shared.mutex);
+    shared.done.wait(lock, [&shared] { return shared.pending == 0; });
+
+    m_nodes += shared.nodes;
+    m_count += shared.count;
+    m_backtracks += shared.backtracks;
+    m_propagations += shared.propagations;
+    m_max_depth = shared.max_depth;
+    m_found = shared.found;
+    m_budget_exceeded = shared.budget_exceeded;
+    if (m_found > 0) {
+        m_grid = shared.first;
+    }
+    end_search();
+    return m_found;
+}
+
+template <int Box>
+bool BasicBoard<Box>::branch_cell(int& cell, Mask& candidates, int start)
+{
+    if (m_heuristic == Heuristic::fewest_candidates) {
+        if (m_randomize) return random_fewest_cell(cell, candidates);
+        return fewest_cell(cell, candidates);
+    }
+
+    for (int i = start; i < cells; ++i) {
+        if (m_cells[i] != 0) continue;
+
+        cell = i;
+        candidates = free_entries(i);
+        return true;
     }
     return false;
 }
 
-bool Board::valid(const std::array<std::array<int, 9>, 9>& grid,
-                  int row, int col, int entry)
+template <int Box>
+bool BasicBoard<Box>::fewest_cell(int& cell, Mask& candidates) const
 {
-    // Test rows and columns
-    bool valid = true;
-    for (int i = 0; i < 9; ++i) {
-        if ((grid[row][i] == entry && i != col) ||
-            (grid[i][col] == entry && i != row)) {
-            valid = false;
-            break;
+    int best_count = size + 1;
+    for (int i = 0; i < cells; ++i) {
+        if (m_cells[i] != 0) continue;
+
+        Mask free = free_entries(i);
+        int count = bit_count(free);
+        if (count < best_count) {
+            cell = i;
+            candidates = free;
+            best_count = count;
+            if (count <= 2) break;
         }
     }
+    return best_count <= size;
+}
 
-    // Test groups of nine
-    int row_group = row / 3;
-    int col_group = col / 3;
-    for (int i_row = 0; i_row < 3; ++i_row) {
-        if (!valid) break;
-        for (int i_col = 0; i_col < 3; ++i_col) {
-            if (col_group*3+i_col == col || row_group*3+i_row == row) continue;
-            if (!valid) break;
-            if (grid[row_group*3+i_row][col_group*3+i_col] == entry) {
-                valid = false;
+template <>
+bool BasicBoard<3>::fewest_cell(int& cell, Mask& candidates) const
+{
+    static_assert(sizeof(m_cells) >= simd_buffer_size,
+                  "cells must be padded for the vector kernels");
+    int found = simd_fewest_candidates(m_units.data(), m_cells.data(),
+                                       candidates);
+    if (found < 0) {
+        return false;
+    }
+    cell = found;
+    return true;
+}
+
+template <int Box>
+bool BasicBoard<Box>::random_fewest_cell(int& cell, Mask& candidates)
+{
+    Candidates all;
+    fill_candidates(all);
+
+    // Each of the ties seen so far is kept with equal chance
+    int best_count = size + 1;
+    unsigned int ties = 0;
+    for (int i = 0; i < cells; ++i) {
+        if (m_cells[i] != 0) continue;
+
+        int count = bit_count(all[i]);
+        if (count < best_count) {
+            best_count = count;
+            ties = 0;
+        }
+        if (count == best_count && next_random() % ++ties == 0) {
+            cell = i;
+            candidates = all[i];
+        }
+    }
+    return best_count <= size;
+}
+
+template <int Box>
+void BasicBoard<Box>::fill_candidates(Candidates& out) const
+{
+    for (int i = 0; i < cells; ++i) {
+        out[i] = (m_cells[i] == 0 ? free_entries(i) : 0);
+    }
+}
+
+template <>
+void BasicBoard<3>::fill_candidates(Candidates& out) const
+{
+    static_assert(sizeof(Candidates) / sizeof(Mask) >= simd_buffer_size,
+                  "candidates must be padded for the vector kernels");
+    simd_candidates(m_units.data(), m_cells.data(), out.data());
+}
+
+template <int Box>
+void BasicBoard<Box>::begin_search()
+{
+    m_count = 0;
+    m_nodes = 0;
+    m_backtracks = 0;
+    m_propagations = 0;
+    m_max_depth = 0;
+    m_root_depth = 0;
+    m_restarts = 0;
+    m_found = 0;
+    m_budget_exceeded = false;
+    m_random = m_seed;
+    m_randomize = (m_value_order == ValueOrder::random);
+    if (m_collect_stats) {
+        m_stats = SolveStats();
+        m_stats.start = SolveStats::Clock::now();
+    }
+
+    if (m_time_budget.count() > 0) {
+        m_deadline = std::chrono::steady_clock::now() + m_time_budget;
+    } else {
+        m_deadline = std::chrono::steady_clock::time_point::max();
+    }
+}
+
+template <int Box>
+void BasicBoard<Box>::end_validation()
+{
+    if (m_collect_stats) {
+        m_stats.validate_time = SolveStats::Clock::now() - m_stats.start;
+    }
+}
+
+template <int Box>
+void BasicBoard<Box>::end_search()
+{
+    if (m_collect_stats) {
+        m_stats.search_time = SolveStats::Clock::now() - m_stats.start -
+                              m_stats.validate_time;
+        m_stats.nodes = m_nodes;
+        m_stats.backtracks = m_backtracks;
+        m_stats.max_depth = m_max_depth;
+        m_stats.propagations = m_propagations;
+        m_stats.restarts = m_restarts;
+        m_stats.solves = 1;
+    }
+
+    if (m_cancel.get()) {
+        m_result = Result::cancelled;
+    } else if (m_budget_exceeded) {
+        m_result = Result::budget_exceeded;
+    } else if (m_found > 0) {
+        m_result = Result::solved;
+    } else {
+        m_result = Result::unsolvable;
+    }
+}
+
+template <int Box>
+inline bool BasicBoard<Box>::stopped()
+{
+    if (m_cancel.get()) {
+        return true;
+    }
+    if (m_shared && (m_shared->stop.load(std::memory_order_relaxed) ||
+                     m_shared->cancel->get())) {
+        return true;
+    }
+    if (m_nodes >= m_attempt_end) {
+        m_restart_due = true;
+        return true;
+    }
+
+    bool exceeded = false;
+    if (!m_shared && m_node_budget > 0 && m_nodes >= m_node_budget) {
+        exceeded = true;
+    } else if ((m_nodes & 1023) == 0 && m_nodes > 0) {
+        // The clock and the shared node count are only looked at every 1024
+        // nodes, to keep them off the hot path
+        if (m_shared && m_node_budget > 0 &&
+                (m_shared->progress += 1024) >= m_node_budget) {
+            exceeded = true;
+        }
+        if (m_time_budget.count() > 0 &&
+                std::chrono::steady_clock::now() >= m_deadline) {
+            exceeded = true;
+        }
+    }
+
+    if (exceeded) {
+        m_budget_exceeded = true;
+        if (m_shared) {
+            m_shared->budget_exceeded = true;
+            m_shared->stop = true;
+        }
+    }
+    return exceeded;
+}
+
+template <int Box>
+bool BasicBoard<Box>::record_solution()
+{
+    if (m_shared) {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        if (m_shared->found >= m_shared->limit) {
+            return true;
+        }
+        if (m_shared->found == 0) {
+            for (int i = 0; i < cells; ++i) {
+                m_shared->first[i / size][i % size] = m_cells[i];
             }
         }
+        if (++m_shared->found >= m_shared->limit) {
+            m_shared->stop = true;
+            return true;
+        }
+        return false;
+    }
+
+    if (m_found == 0) {
+        for (int i = 0; i < cells; ++i) {
+            m_grid[i / size][i % size] = m_cells[i];
+        }
+        // Restarting now would find this solution again
+        m_attempt_end = ULONG_MAX;
+    }
+    return ++m_found >= m_limit;
+}
+
+template <int Box>
+bool BasicBoard<Box>::load_grid()
+{
+    m_units.fill(0);
+    m_trail_size = 0;
+    m_empty_cells = 0;
+
+    for (int i = 0; i < cells; ++i) {
+        int entry = m_grid[i / size][i % size];
+        m_cells[i] = static_cast<unsigned char>(entry);
+        if (entry == 0) {
+            m_empty_cells++;
+            continue;
+        }
+
+        Mask bit = static_cast<Mask>(1u << (entry - 1));
+        if (!(free_entries(i) & bit)) {
+            return false;
+        }
+        for (int unit : geometry<Box>.units_of[i]) {
+            m_units[unit] |= bit;
+        }
+    }
+    return true;
+}
+
+template <int Box>
+inline typename BasicBoard<Box>::Mask
+BasicBoard<Box>::free_entries(int cell) const
+{
+    const auto& units = geometry<Box>.units_of[cell];
+    return static_cast<Mask>(~(m_units[units[0]] | m_units[units[1]] |
+                               m_units[units[2]]) & all_entries);
+}
+
+template <int Box>
+inline void BasicBoard<Box>::make(int cell, int entry)
+{
+    Mask bit = static_cast<Mask>(1u << (entry - 1));
+    m_cells[cell] = static_cast<unsigned char>(entry);
+    const auto& units = geometry<Box>.units_of[cell];
+    m_units[units[0]] |= bit;
+    m_units[units[1]] |= bit;
+    m_units[units[2]] |= bit;
+    m_trail[m_trail_size++] = static_cast<Index>(cell);
+}
+
+template <int Box>
+inline void BasicBoard<Box>::undo(int mark)
+{
+    while (m_trail_size > mark) {
+        int cell = m_trail[--m_trail_size];
+        Mask bit = static_cast<Mask>(~(1u << (m_cells[cell] - 1)));
+        m_cells[cell] = 0;
+        const auto& units = geometry<Box>.units_of[cell];
+        m_units[units[0]] &= bit;
+        m_units[units[1]] &= bit;
+        m_units[units[2]] &= bit;
+    }
+}
+
+template <int Box>
+bool BasicBoard<Box>::contradictory()
+{
+    for (int cell = 0; cell < cells; ++cell) {
+        int entry = m_grid[cell / size][cell % size];
+        if (entry != 0 && !valid(m_grid, cell / size, cell % size, entry)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <>
+bool BasicBoard<3>::contradictory()
+{
+    std::array<unsigned char, simd_buffer_size> grid = {};
+    for (int cell = 0; cell < cells; ++cell) {
+        grid[cell] = static_cast<unsigned char>(m_grid[cell / 9][cell % 9]);
     }
+    return simd_duplicates(grid.data());
+}
 
-    return valid;
+template <int Box>
+bool BasicBoard<Box>::valid(const Grid& grid, int row, int col, int entry)
+{
+    // Test every cell sharing a row, column, or square, without branching
+    bool clash = false;
+    for (int peer : geometry<Box>.peers[row * size + col]) {
+        clash |= (grid[peer / size][peer % size] == entry);
+    }
+    return !clash;
 }
 
-std::array<int, 9>& Board::operator[](int row)
+template <int Box>
+std::array<int, BasicBoard<Box>::size>& BasicBoard<Box>::operator[](int row)
 {
     return m_grid[row];
 }
 
-const std::array<int, 9>& Board::operator[](int row) const
+template <int Box>
+const std::array<int, BasicBoard<Box>::size>&
+BasicBoard<Box>::operator[](int row) const
 {
     return m_grid[row];
 }
 
-void Board::clear()
+template <int Box>
+void BasicBoard<Box>::clear()
 {
-    for (std::size_t row = 0; row < 9; ++row) {
-        for (std::size_t col = 0; col < 9; ++col) {
+    for (std::size_t row = 0; row < size; ++row) {
+        for (std::size_t col = 0; col < size; ++col) {
             m_grid[row][col] = 0;
         }
     }
 }
 
-void Board::cancel()
+template <int Box>
+void BasicBoard<Box>::cancel()
 {
-    m_cancel = true;
+    m_cancel.set(true);
 }
 
-bool Board::solve(std::array<std::array<int, 9>, 9> grid)
+template <int Box>
+bool BasicBoard<Box>::search(int depth, bool enter)
 {
-    if (m_cancel) {
+    const bool fewest = (m_heuristic == Heuristic::fewest_candidates);
+    // Whether numbers are tried from 1 up, as the plain loop would
+    const bool in_order = (!fewest && !m_randomize &&
+                           m_value_order == ValueOrder::ascending);
+
+    // Every level of the stack places at least one number, so the tree is at
+    // most one level per cell deep
+    while (true) {
+        Frame& frame = m_stack[depth];
+
+        if (enter) {
+            if (stopped()) {
+                return true;
+            }
+            m_nodes++;
+            if (depth > m_max_depth) m_max_depth = depth;
+            frame.entry_mark = static_cast<Index>(m_trail_size);
+
+            // Without propagation, every cell before the parent's is filled
+            int cell = 0;
+            int start = 0;
+            if (!fewest && depth > 0) start = m_stack[depth - 1].cell + 1;
+            bool alive = place_forced(start);
+            if (alive && (m_trail_size == m_empty_cells ||
+                          !branch_cell(cell, frame.candidates, start))) {
+                if (record_solution()) {
+                    m_depth = depth;
+                    return true;
+                }
+                alive = false;
+            }
+            if (!alive) {
+                if (!backtrack(depth)) return false;
+                enter = false;
+                continue;
+            }
+            frame.cell = static_cast<Index>(cell);
+            frame.branch_mark = static_cast<Index>(m_trail_size);
+            frame.tested = 0;
+        }
+
+        if (frame.candidates == 0) {
+            // Still count every number that the plain 1 to size loop would
+            // have tested, so count() keeps its meaning
+            if (in_order) m_count += size - frame.tested;
+            if (!backtrack(depth)) return false;
+            enter = false;
+            continue;
+        }
+
+        int entry = take_entry(frame.candidates);
+        if (in_order) {
+            m_count += entry - frame.tested;
+            frame.tested = static_cast<unsigned char>(entry);
+        } else {
+            m_count++;
+        }
+
+        make(frame.cell, entry);
+        ++depth;
+        enter = true;
+    }
+}
+
+template <int Box>
+bool BasicBoard<Box>::begin_enumeration()
+{
+    begin_search();
+    m_limit = ULONG_MAX;
+    bool loaded = !m_cancel.get() && load_grid();
+    end_validation();
+    if (!loaded) {
+        m_enumeration = Enumeration::idle;
+        end_search();
+        return false;
+    }
+    m_enumeration = Enumeration::started;
+    return true;
+}
+
+template <int Box>
+bool BasicBoard<Box>::next_solution()
+{
+    if (m_enumeration == Enumeration::idle) return false;
+
+    // Stop at the very next solution, carrying on from the last one
+    const unsigned long int found = m_found;
+    m_limit = found + 1;
+    if (m_enumeration == Enumeration::started) {
+        search();
+    } else {
+        int depth = m_depth;
+        if (backtrack(depth)) search(depth, false);
+    }
+
+    if (m_found > found) {
+        m_enumeration = Enumeration::at_solution;
+        for (int i = 0; i < cells; ++i) {
+            m_grid[i / size][i % size] = m_cells[i];
+        }
         return true;
     }
+    m_enumeration = Enumeration::idle;
+    end_search();
+    return false;
+}
 
-    int row, col;
-    bool found = false;
-    for (row = 0; row < 9; ++row) {
-        for (col = 0; col < 9; ++col) {
-            if (grid[row][col] == 0) found = true;
-            if (found) break;
+template <int Box>
+typename BasicBoard<Box>::Checkpoint BasicBoard<Box>::checkpoint() const
+{
+    Checkpoint checkpoint;
+    checkpoint.heuristic = m_heuristic;
+    checkpoint.value_order = m_value_order;
+    checkpoint.random = m_random;
+    checkpoint.found = m_found;
+    checkpoint.nodes = m_nodes;
+    checkpoint.count = m_count;
+    checkpoint.finished = (m_enumeration == Enumeration::idle);
+
+    // The givens are the cells the search hasn't filled
+    std::array<unsigned char, cells> cells_now;
+    std::copy(m_cells.begin(), m_cells.begin() + cells, cells_now.begin());
+    for (int i = 0; i < m_trail_size; ++i) cells_now[m_trail[i]] = 0;
+    for (int i = 0; i < cells; ++i) {
+        checkpoint.givens[i / size][i % size] = cells_now[i];
+    }
+
+    if (m_enumeration == Enumeration::at_solution) {
+        for (int depth = 0; depth < m_depth; ++depth) {
+            const Frame& frame = m_stack[depth];
+            typename Checkpoint::Step step;
+            step.cell = frame.cell;
+            step.entry = m_cells[frame.cell];
+            step.candidates = frame.candidates;
+            step.tested = frame.tested;
+            checkpoint.steps.push_back(step);
         }
-        if (found) break;
     }
-    if (!found) {
-        m_grid = grid;
+    return checkpoint;
+}
+
+template <int Box>
+bool BasicBoard<Box>::resume(const Checkpoint& checkpoint)
+{
+    m_grid = checkpoint.givens;
+    m_heuristic = checkpoint.heuristic;
+    m_value_order = checkpoint.value_order;
+    if (!begin_enumeration()) return false;
+
+    m_random = checkpoint.random;
+    m_found = checkpoint.found;
+    m_nodes = checkpoint.nodes;
+    m_count = checkpoint.count;
+    if (checkpoint.finished) {
+        m_enumeration = Enumeration::idle;
+        end_search();
         return true;
     }
+    if (m_found == 0) return true;
 
-    for (int entry = 1; entry < 10; ++entry) {
-        m_count++;
-        if (valid(grid, row, col, entry)) {
-            grid[row][col] = entry;
-            if (solve(grid)) return true;
+    // Make every level's move again, letting propagation place the rest
+    // just as the search did
+    const bool fewest = (m_heuristic == Heuristic::fewest_candidates);
+    const int depth = static_cast<int>(checkpoint.steps.size());
+    if (depth > cells) return false;
+    for (int level = 0; level <= depth; ++level) {
+        Frame& frame = m_stack[level];
+        frame.entry_mark = static_cast<Index>(m_trail_size);
+        int start = 0;
+        if (!fewest && level > 0) start = checkpoint.steps[level - 1].cell + 1;
+        if (!place_forced(start)) return false;
+        if (level == depth) break;
+
+        const typename Checkpoint::Step& step = checkpoint.steps[level];
+        if (step.cell < 0 || step.cell >= cells || m_cells[step.cell] != 0 ||
+                step.entry < 1 || step.entry > size ||
+                !(free_entries(step.cell) & (1u << (step.entry - 1))) ||
+                (step.candidates & ~static_cast<unsigned int>(all_entries))) {
+            return false;
         }
+        frame.cell = static_cast<Index>(step.cell);
+        frame.branch_mark = static_cast<Index>(m_trail_size);
+        frame.candidates = static_cast<Mask>(step.candidates);
+        frame.tested = static_cast<unsigned char>(step.tested);
+        make(step.cell, step.entry);
     }
-    return false;
+
+    // The last level must be the solution the checkpoint was taken at
+    for (int i = 0; i < cells; ++i) {
+        if (m_cells[i] == 0) return false;
+        m_grid[i / size][i % size] = m_cells[i];
+    }
+    m_depth = depth;
+    m_enumeration = Enumeration::at_solution;
+    return true;
 }
 
-std::istream& operator>>(std::istream& is, Board& b)
+template <int Box>
+void BasicBoard<Box>::Checkpoint::write(std::ostream& os) const
 {
-    std::array<std::array<int, 9>, 9> grid;
+    os << "sudoku-checkpoint " << checkpoint_version << ' ' << Box << '\n';
+    for (const auto& row : givens) {
+        for (int entry : row) os << digit_char(entry);
+    }
+    os << '\n'
+       << static_cast<int>(heuristic) << ' '
+       << static_cast<int>(value_order) << ' ' << random << ' ' << found
+       << ' ' << nodes << ' ' << count << ' ' << finished << ' '
+       << steps.size() << '\n';
+    for (const Step& step : steps) {
+        os << step.cell << ' ' << step.entry << ' ' << step.candidates << ' '
+           << step.tested << '\n';
+    }
+}
+
+template <int Box>
+bool BasicBoard<Box>::Checkpoint::read(std::istream& is)
+{
+    std::string magic, line;
+    int version = 0, box = 0;
+    if (!(is >> magic >> version >> box >> line) ||
+            magic != "sudoku-checkpoint" || version != checkpoint_version ||
+            box != Box ||
+            line.size() != static_cast<std::size_t>(cells)) {
+        return false;
+    }
+    for (int i = 0; i < cells; ++i) {
+        int entry = (line[i] == '.' ? 0 : digit_value(line[i]));
+        if (entry < 0 || entry > size) return false;
+        givens[i / size][i % size] = entry;
+    }
+
+    int heuristic_value, order_value;
+    std::size_t depth;
+    if (!(is >> heuristic_value >> order_value >> random >> found >> nodes
+             >> count >> finished >> depth) ||
+            heuristic_value < 0 || heuristic_value > 1 ||
+            order_value < 0 || order_value > 2 ||
+            depth > static_cast<std::size_t>(cells)) {
+        return false;
+    }
+    heuristic = static_cast<Heuristic>(heuristic_value);
+    value_order = static_cast<ValueOrder>(order_value);
+
+    steps.resize(depth);
+    for (Step& step : steps) {
+        if (!(is >> step.cell >> step.entry >> step.candidates
+                 >> step.tested)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int Box>
+void BasicBoard<Box>::search_with_restarts()
+{
+    for (unsigned long int attempt = 0; ; ++attempt) {
+        unsigned long int units = luby(attempt);
+        m_attempt_end = (units > (ULONG_MAX - m_nodes) / m_restart_unit) ?
+                        ULONG_MAX : m_nodes + units * m_restart_unit;
+
+        m_restart_due = false;
+        search();
+        if (!m_restart_due) break;
+
+        // Back to the givens, choosing at random from now on
+        undo(0);
+        m_restarts++;
+        m_randomize = true;
+    }
+    m_attempt_end = ULONG_MAX;
+    m_restart_due = false;
+}
+
+template <int Box>
+inline std::uint64_t BasicBoard<Box>::next_random()
+{
+    // One step of splitmix64
+    std::uint64_t z = (m_random += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+template <int Box>
+inline int BasicBoard<Box>::take_entry(Mask& candidates)
+{
+    if (!m_randomize && m_value_order == ValueOrder::ascending) {
+        int entry = lowest_bit(candidates) + 1;
+        candidates &= candidates - 1;
+        return entry;
+    }
+
+    int index;
+    if (!m_randomize) {
+        index = highest_bit(candidates);
+    } else {
+        // Uniformly among the candidates
+        Mask rest = candidates;
+        for (int skip = static_cast<int>(next_random() %
+                                         bit_count(candidates));
+                skip > 0; --skip) {
+            rest &= rest - 1;
+        }
+        index = lowest_bit(rest);
+    }
+    candidates &= static_cast<Mask>(~(1u << index));
+    return index + 1;
+}
+
+template <int Box>
+inline bool BasicBoard<Box>::backtrack(int& depth)
+{
+    m_backtracks++;
+    undo(m_stack[depth].entry_mark);
+    if (depth == 0) {
+        return false;
+    }
+    --depth;
+    undo(m_stack[depth].branch_mark);
+    return true;
+}
+
+template <int Box>
+bool BasicBoard<Box>::propagate()
+{
+    // Each pass works from a snapshot of every cell's candidates. Placing a
+    // number only ever removes candidates, so a snapshot can go stale but
+    // never wrong; cells are checked again before anything is placed.
+    Candidates snapshot;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        fill_candidates(snapshot);
+
+        // Naked singles: cells with only one candidate left
+        for (int cell = 0; cell < cells; ++cell) {
+            if (m_cells[cell] != 0) continue;
+            if (snapshot[cell] & (snapshot[cell] - 1)) continue;
+
+            Mask candidates = free_entries(cell);
+            if (candidates == 0) return false;
+            if (candidates & (candidates - 1)) continue;
+
+            m_count++;
+            m_propagations++;
+            make(cell, lowest_bit(candidates) + 1);
+            progress = true;
+        }
+        if (progress) continue;
+
+        // Hidden singles: numbers with only one place left in a unit
+        for (int unit = 0; unit < units; ++unit) {
+            Mask once = 0, twice = 0, filled = 0;
+            for (int i = 0; i < size; ++i) {
+                int cell = geometry<Box>.unit_cells[unit][i];
+                if (m_cells[cell] != 0) {
+                    filled |= 1u << (m_cells[cell] - 1);
+                    continue;
+                }
+                Mask candidates = snapshot[cell];
+                twice |= once & candidates;
+                once |= candidates;
+            }
+            if ((once | filled) != all_entries) return false;
+
+            Mask singles = once & ~twice;
+            while (singles) {
+                int entry = lowest_bit(singles) + 1;
+                singles &= singles - 1;
+
+                for (int i = 0; i < size; ++i) {
+                    int cell = geometry<Box>.unit_cells[unit][i];
+                    if (m_cells[cell] != 0) continue;
+                    if (!(free_entries(cell) & (1u << (entry - 1)))) continue;
+
+                    m_count++;
+                    m_propagations++;
+                    make(cell, entry);
+                    progress = true;
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <int Box>
+bool BasicBoard<Box>::place_forced(int start)
+{
+    // The last few cells of an enumeration are mostly forced, and filled
+    // without a frame each. Hidden singles are left to branching there, as
+    // looking for them costs more than the few nodes they save.
+    if (m_enumeration != Enumeration::idle &&
+            m_empty_cells - m_trail_size <= leaf_cells) {
+        return fill_leaf(start);
+    }
+    return m_heuristic != Heuristic::fewest_candidates || propagate();
+}
+
+template <int Box>
+bool BasicBoard<Box>::fill_leaf(int start)
+{
+    // Every empty cell lies from start on, so one pass finds them all
+    std::array<Index, leaf_cells> empty;
+    const int left = m_empty_cells - m_trail_size;
+    int found = 0;
+    for (int cell = start; cell < cells && found < left; ++cell) {
+        if (m_cells[cell] == 0) empty[found++] = static_cast<Index>(cell);
+    }
+
+    bool progress = true;
+    while (progress && found > 0) {
+        progress = false;
+        for (int i = 0; i < found;) {
+            Mask candidates = free_entries(empty[i]);
+            if (candidates == 0) return false;
+            if (candidates & (candidates - 1)) {
+                ++i;
+                continue;
+            }
+
+            m_count++;
+            m_propagations++;
+            make(empty[i], lowest_bit(candidates) + 1);
+            empty[i] = empty[--found];
+            progress = true;
+        }
+    }
+    return true;
+}
+
+template <int Box>
+std::istream& operator>>(std::istream& is, BasicBoard<Box>& b)
+{
+    const int size = BasicBoard<Box>::size;
+    typename BasicBoard<Box>::Grid grid = {};
     std::string line;
     int row = 0;
     while (std::getline(is, line)) {
         // Accept that some lines will be dashes for formatting.
         if (line[1] == '-') continue;
 
-        // Only accept 9 lines of actual input.
-        if (row > 9-1) break;
+        // Only accept size lines of actual input.
+        if (row > size-1) break;
 
         // Otherwise, read in digits (as characters, so that 123 is read as
         // three separate numbers).
@@ -172,26 +1168,71 @@ std::istream& operator>>(std::istream& is, Board& b)
             // Ignore whitespace or other formatting.
             if (ch == ' ' || ch == '|') continue;
 
-            // Don't accept more that 9 columns of actual input, nor anything
-            // that isn't formatting or numbers.
-            if (/*column > 9-1 || */!std::isdigit(ch)) {
+            // Don't accept more that size columns of actual input, nor
+            // anything that isn't formatting or a number that fits.
+            int entry = digit_value(ch);
+            if (column > size-1 || entry < 0 || entry > size) {
                 is.setstate(std::ios::failbit);
                 return is;
             }
 
-            grid[row][column] = ch - '0';
+            grid[row][column] = entry;
             column++;
         }
         row++;
     }
 
-    b = Board(grid);
+    b = BasicBoard<Box>(grid);
     is.clear(std::ios_base::goodbit);
     return is;
 }
 
-std::ostream& operator<<(std::ostream& os, const Board& b)
+template <int Box>
+std::ostream& operator<<(std::ostream& os, const BasicBoard<Box>& b)
 {
     return os << b.str();
 }
 
+template <int Box>
+bool read_line(const char* line, std::size_t length, BasicBoard<Box>& b)
+{
+    const int size = BasicBoard<Box>::size;
+    const int cells = BasicBoard<Box>::cells;
+    if (length < static_cast<std::size_t>(cells)) {
+        return false;
+    }
+
+    typename BasicBoard<Box>::Grid grid;
+    for (int i = 0; i < cells; ++i) {
+        int entry = (line[i] == '.' ? 0 : digit_value(line[i]));
+        if (entry < 0 || entry > size) {
+            return false;
+        }
+        grid[i / size][i % size] = entry;
+    }
+
+    b = BasicBoard<Box>(grid);
+    return true;
+}
+
+template <int Box>
+void write_line(const BasicBoard<Box>& b, char* out)
+{
+    const int size = BasicBoard<Box>::size;
+    for (int i = 0; i < BasicBoard<Box>::cells; ++i) {
+        out[i] = digit_char(b[i / size][i % size]);
+    }
+}
+
+#define INSTANTIATE_BOARD(Box) \
+    template class BasicBoard<Box>; \
+    template std::istream& operator>>(std::istream&, BasicBoard<Box>&); \
+    template std::ostream& operator<<(std::ostream&, \
+                                      const BasicBoard<Box>&); \
+    template bool read_line(const char*, std::size_t, BasicBoard<Box>&); \
+    template void write_line(const BasicBoard<Box>&, char*);
+
+INSTANTIATE_BOARD(2)
+INSTANTIATE_BOARD(3)
+INSTANTIATE_BOARD(4)
+INSTANTIATE_BOARD(5)
@@ -2,55 +2,486 @@
 #define SUDOKU_H
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "solve_stats.h"
+
+class ThreadPool;
 
 /*
- * Represent sudoku grid as 9 by 9 array of ints, with 0 representing an
- * unfilled square.
+ * Flag that may be set from one thread while another thread reads it.
+ * Unlike std::atomic<bool> it can be copied, so boards holding one stay
+ * copyable.
  */
 
-class Board {
+class AtomicFlag {
 public:
-    Board();
-    Board(const std::array<std::array<int, 9>, 9>& grid);
+    AtomicFlag(bool value = false) : m_value(value) {}
+    AtomicFlag(const AtomicFlag& other) : m_value(other.get()) {}
+    AtomicFlag& operator=(const AtomicFlag& other)
+    {
+        set(other.get());
+        return *this;
+    }
+
+    bool get() const { return m_value.load(std::memory_order_relaxed); }
+    void set(bool value) { m_value.store(value, std::memory_order_relaxed); }
+
+    const std::atomic<bool>& atomic() const { return m_value; }
+private:
+    std::atomic<bool> m_value;
+};
 
-    std::array<int, 9>& operator[](int row);
-    const std::array<int, 9>& operator[](int row) const;
+/*
+ * Settings and outcomes shared by boards of every size.
+ */
+
+class BoardBase {
+public:
+    // How the solver picks the next empty cell to branch on
+    enum class Heuristic {
+        // The first empty cell in row-major order
+        first_empty,
+        // The cell with the fewest candidates, after placing every naked and
+        // hidden single
+        fewest_candidates
+    };
+
+    // Order in which the solver tries the candidates of the cell it branches
+    // on. Dancing Links always tries them in ascending order.
+    enum class ValueOrder {
+        ascending,
+        descending,
+        // Drawn from the board's own generator, which with
+        // fewest_candidates also breaks ties between cells (see set_seed())
+        random
+    };
+
+    // Which search engine solve() uses
+    enum class Backend {
+        // Recursive backtracking over cells, see Heuristic
+        backtracking,
+        // Exact cover search with Dancing Links (see dlx.h)
+        dancing_links
+    };
+
+    // Outcome of the last search
+    enum class Result {
+        solved,
+        unsolvable,
+        cancelled,
+        // Gave up after the time or node budget ran out
+        budget_exceeded
+    };
+};
+
+/*
+ * Represent sudoku grid made of Box by Box squares (so a classic 9 by 9
+ * grid has Box 3) as an array of ints, with 0 representing an unfilled
+ * square. The geometry, and with it the width of the occupancy masks, is
+ * fixed at compile time. Boards with Box from 2 to 5 are compiled in
+ * sudoku.cpp.
+ */
+
+template <int Box>
+class BasicBoard : public BoardBase {
+public:
+    // Numbers per unit, which is also the width and height of the grid, and
+    // the number of cells and units (rows, columns, and squares)
+    static constexpr int box = Box;
+    static constexpr int size = Box * Box;
+    static constexpr int cells = size * size;
+    static constexpr int units = 3 * size;
+
+    typedef std::array<std::array<int, size>, size> Grid;
+
+    BasicBoard();
+    BasicBoard(const Grid& grid);
+
+    std::array<int, size>& operator[](int row);
+    const std::array<int, size>& operator[](int row) const;
 
     std::string str() const;
     // Returns the count of how many numbers were tested overall before
     // finding the correct number everywhere
     unsigned long int count() const { return m_count; }
+    // Returns how many nodes of the search tree were visited
+    unsigned long int nodes() const { return m_nodes; }
+
+    Heuristic heuristic() const { return m_heuristic; }
+    void set_heuristic(Heuristic heuristic) { m_heuristic = heuristic; }
+
+    ValueOrder value_order() const { return m_value_order; }
+    void set_value_order(ValueOrder order) { m_value_order = order; }
+
+    // Seeds the generator behind ValueOrder::random and restarts. Boards
+    // are seeded with 0. Every search starts the generator from the seed,
+    // so the same seed always gives the same search.
+    void set_seed(std::uint64_t seed) { m_seed = seed; }
+    std::uint64_t seed() const { return m_seed; }
+
+    // Restarts a search from the givens once it has visited unit nodes,
+    // then after the Luby sequence (1, 1, 2, 1, 1, 2, 4, ...) times unit
+    // nodes more on each later attempt. Attempts after the first choose at
+    // random as ValueOrder::random does, so a puzzle that is pathological
+    // for the board's own orders gets fresh chances, while one solved
+    // within unit nodes is searched exactly as without restarts. Once a
+    // solution turns up the attempt runs to the end, so none is counted
+    // twice. 0, the default, turns restarts off. Parallel and Dancing Links
+    // searches never restart.
+    void set_restart_unit(unsigned long int unit) { m_restart_unit = unit; }
+    unsigned long int restart_unit() const { return m_restart_unit; }
+    // Restarts made by the last search
+    unsigned long int restarts() const { return m_restarts; }
+
+    Backend backend() const { return m_backend; }
+    void set_backend(Backend backend) { m_backend = backend; }
+
+    // Limits on how long each search may run, in wall clock time and in
+    // search nodes. 0 means no limit.
+    void set_time_budget(std::chrono::milliseconds budget)
+    {
+        m_time_budget = budget;
+    }
+    void set_node_budget(unsigned long int budget) { m_node_budget = budget; }
+
+    Result result() const { return m_result; }
+
+    // Whether searches fill in stats(). Off by default, in which case the
+    // clock is never read.
+    void set_collect_stats(bool collect) { m_collect_stats = collect; }
+    bool collect_stats() const { return m_collect_stats; }
+    // Stats of the last search, while collecting. parse_time is left for
+    // the caller.
+    const SolveStats& stats() const { return m_stats; }
 
     // Returns false if grid is unsolvable (doesn't determine if a solution
     // is unique)
     bool solve();
 
+    // Searches past the first solution, stopping once limit solutions have
+    // been found (or searching exhaustively if limit is 0). Returns the
+    // number found, so a limit of 2 tells whether the solution is unique.
+    // The first solution found is kept in the board.
+    unsigned long int count_solutions(unsigned long int limit);
+
+    // Same as above, but splits the top of the search tree into subtrees
+    // searched concurrently on pool. Once limit solutions are found the
+    // remaining subtrees give up. count() and nodes() add up the work of
+    // every subtree. Always backtracks, whatever backend(), and must not be
+    // called from one of the pool's own workers.
+    unsigned long int count_solutions(unsigned long int limit,
+                                      ThreadPool& pool);
+    bool solve(ThreadPool& pool);
+
+    // Enumerates every solution while holding only the current one, so
+    // memory stays the same however many there are. begin_enumeration()
+    // loads the givens, returning false if they contradict each other, and
+    // each next_solution() carries the search on to the next solution and
+    // leaves it in the board. next_solution() returns false once the search
+    // is exhausted, cancelled or out of budget (see result()). Solutions
+    // come in the order of heuristic() and value_order(); Dancing Links and
+    // restarts don't apply.
+    bool begin_enumeration();
+    bool next_solution();
+
+    // Calls visit(board) with each solution in turn, until it returns false
+    // or there are no more. Returns the number of solutions visited.
+    template <typename Visit>
+    unsigned long int enumerate(Visit visit)
+    {
+        unsigned long int visited = 0;
+        if (!begin_enumeration()) return 0;
+        while (next_solution()) {
+            ++visited;
+            if (!visit(static_cast<const BasicBoard&>(*this))) break;
+        }
+        return visited;
+    }
+
+    /*
+     * Where an enumeration stands: the givens, and the number placed and
+     * the candidates left at each level of the search down to the last
+     * solution. That is all it takes to carry on, since everything else is
+     * placed again by propagation, so a checkpoint is at most one small
+     * step per cell whatever the number of solutions.
+     */
+    struct Checkpoint {
+        struct Step {
+            int cell;
+            int entry;
+            // Candidates of the cell still to be tried, and the last
+            // number tested, for count()
+            unsigned int candidates;
+            int tested;
+        };
+
+        Grid givens;
+        Heuristic heuristic;
+        ValueOrder value_order;
+        std::uint64_t random;
+        unsigned long int found;
+        unsigned long int nodes;
+        unsigned long int count;
+        // Whether the enumeration had already ended
+        bool finished;
+        std::vector<Step> steps;
+
+        // As text, a few lines long. read() returns false if the stream
+        // doesn't hold a checkpoint of a board this size.
+        void write(std::ostream& os) const;
+        bool read(std::istream& is);
+    };
+
+    // Checkpoint of the enumeration, taken between next_solution() calls
+    Checkpoint checkpoint() const;
+    // Carries on the enumeration of a checkpoint as if begin_enumeration()
+    // and the next_solution() calls up to it had been made here, setting
+    // the heuristic and value order it was taken with. Returns false if the
+    // checkpoint doesn't hold a position the search could have reached.
+    bool resume(const Checkpoint& checkpoint);
+
     // Clears class data
     void clear();
 
     // Cancel the board. Do not allow it to be solved, and make any currently
-    // running solve loop exit
+    // running solve loop exit. Safe to call from another thread while the
+    // board is solving.
     void cancel();
 
     // Checks if the grid has any immediate contradictions (the same numbers
     // sharing rows, columns, or squares)
     bool contradictory();
 private:
+    // State shared by the subtrees of a parallel search
+    struct SharedSearch;
+
+    // Set of numbers, bit (entry-1) standing for entry
+    typedef typename std::conditional<(size <= 16), unsigned short,
+                                      unsigned int>::type Mask;
+    static constexpr Mask all_entries = static_cast<Mask>((1u << size) - 1);
+
+    // Wide enough to hold any cell index, or the size of the undo stack
+    typedef typename std::conditional<(cells < 256), unsigned char,
+                                      unsigned short>::type Index;
+
+    // Empty cells at most left for an enumeration to fill the forced ones
+    // directly (see fill_leaf())
+    static constexpr int leaf_cells = 24;
+
     // Checks whether an entry is valid in a given sudoku board
-    bool valid(const std::array<std::array<int, 9>, 9>& grid,
-               int row, int col, int entry);
+    bool valid(const Grid& grid, int row, int col, int entry);
+
+    // Searches from the current search state, in place, starting at the
+    // given level of the stack, either entering it or carrying on with its
+    // next candidate. Returns true once the search should stop (enough
+    // solutions found, cancelled, or out of budget), with m_depth set to
+    // the level of the last solution.
+    bool search(int depth = 0, bool enter = true);
+
+    // Searches in attempts of growing size, see set_restart_unit()
+    void search_with_restarts();
+
+    // Pops search frames that have run out of candidates, undoing their
+    // moves, until one with candidates left is on top. Returns false once
+    // the bottom frame has been popped.
+    bool backtrack(int& depth);
+
+    // Picks the cell to branch on, following m_heuristic and looking no
+    // further back than start. Returns false if every cell is filled.
+    bool branch_cell(int& cell, Mask& candidates, int start = 0);
+
+    // Same as above, picking at random among the cells with the fewest
+    // candidates
+    bool random_fewest_cell(int& cell, Mask& candidates);
+
+    // Takes the next number to try out of a non-empty set of candidates,
+    // following m_value_order, or at random while m_randomize is set
+    int take_entry(Mask& candidates);
+
+    // Next number of the generator behind random choices
+    std::uint64_t next_random();
+
+    // Finds an empty cell with the fewest candidates. Returns false if
+    // every cell is filled. 9 by 9 boards use the vector kernels of simd.h,
+    // which pick the first such cell.
+    bool fewest_cell(int& cell, Mask& candidates) const;
+
+    // Candidates of every cell, 0 for filled ones. Padded like m_cells, so
+    // that vector kernels can store whole rows.
+    typedef std::array<Mask, cells + 16> Candidates;
+    void fill_candidates(Candidates& out) const;
+
+    // Whether a running search should give up, because it was cancelled or
+    // ran out of budget
+    bool stopped();
+
+    // Starts the budget clock and the result of a new search
+    void begin_search();
+    // Ends the validate phase of the stats, once the grid is loaded
+    void end_validation();
+    // Sets m_result once a search is over, and the stats if collecting
+    void end_search();
+
+    // Records the filled search state as a solution. Returns true once the
+    // limit has been reached.
+    bool record_solution();
+
+    // Places every naked and hidden single, repeating until none are left.
+    // Returns false if a cell or a number has nowhere to go.
+    bool propagate();
+
+    // Places what a node of the search places before it branches: the
+    // singles in fewest_candidates mode, and in an enumeration the forced
+    // cells near the bottom (cells before start are known to be filled).
+    // Returns false at a dead end.
+    bool place_forced(int start);
 
-    // Returns false if a grid is unsolvable
-    // Recursive function
-    bool solve(std::array<std::array<int, 9>, 9> grid);
+    // Places the number of every empty cell from start on that has only
+    // one left, repeating until none are left, with no more than
+    // leaf_cells empty. Near the bottom of an enumeration this stands in
+    // for the frames of forced cells and for most of propagate(). Returns
+    // false if a cell has no number left.
+    bool fill_leaf(int start);
 
-    std::array<std::array<int, 9>, 9> m_grid;
+    // Loads m_grid into the search state, with an empty undo stack, and
+    // counts its empty cells. Returns false if the same number appears
+    // twice in any row, column, or square
+    bool load_grid();
+
+    // Numbers still free for an empty cell, as a mask
+    Mask free_entries(int cell) const;
+
+    // Places an entry in a cell, pushing the cell on the undo stack, and
+    // takes back every move made since the undo stack had mark entries
+    void make(int cell, int entry);
+    void undo(int mark);
+
+    Grid m_grid;
+
+    // Occupancy masks for each unit: the rows, then the columns, then the
+    // squares. Bit (entry-1) is set when entry is already present, so an
+    // entry's validity in a cell is a single AND of the cell's three masks.
+    std::array<Mask, units> m_units;
+
+    // Search state. The search works in place on one byte per cell (as
+    // row*size+col), recording every cell it fills on an undo stack. Each
+    // frame of the explicit search stack remembers the undo stack size on
+    // entry and after its own singles were placed, so backtracking never
+    // copies the grid. The cells are followed by unused padding, so that
+    // vector kernels can load a whole row at the end of the grid.
+    struct Frame {
+        Mask candidates;
+        Index cell;
+        // Last number tested, for count() in first_empty mode
+        unsigned char tested;
+        Index entry_mark;
+        Index branch_mark;
+    };
+    std::array<unsigned char, cells + 16> m_cells;
+    std::array<Index, cells> m_trail;
+    int m_trail_size;
+    // Cells empty once the givens are loaded, so that the search has filled
+    // them all once m_trail_size reaches it
+    int m_empty_cells;
+    std::array<Frame, cells + 1> m_stack;
 
     unsigned long int m_count;
-    bool m_cancel;
+    unsigned long int m_nodes;
+
+    // Counted for the stats whether or not they are collected, which costs
+    // less than checking. m_root_depth is the level a subtree of a
+    // parallel search starts at.
+    unsigned long int m_backtracks;
+    unsigned long int m_propagations;
+    int m_max_depth;
+    int m_root_depth;
+    unsigned long int m_restarts;
+    bool m_collect_stats;
+    SolveStats m_stats;
+
+    // Solutions found so far, and how many to look for
+    unsigned long int m_found;
+    unsigned long int m_limit;
+    Heuristic m_heuristic;
+    ValueOrder m_value_order;
+    // Seed and state of the generator behind random choices, which are made
+    // while m_randomize is set
+    std::uint64_t m_seed;
+    std::uint64_t m_random;
+    bool m_randomize;
+
+    // The current attempt of a restarting search ends once m_nodes reaches
+    // m_attempt_end, setting m_restart_due
+    unsigned long int m_restart_unit;
+    unsigned long int m_attempt_end;
+    bool m_restart_due;
+    Backend m_backend;
+    AtomicFlag m_cancel;
+
+    std::chrono::milliseconds m_time_budget;
+    unsigned long int m_node_budget;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_budget_exceeded;
+    Result m_result;
+
+    // Set while this board searches one subtree of a parallel search
+    SharedSearch* m_shared;
+
+    // Progress of an enumeration
+    enum class Enumeration {
+        // Not enumerating, or every solution has been found
+        idle,
+        // Givens loaded, nothing searched yet
+        started,
+        // Stopped at a solution at level m_depth of the stack
+        at_solution
+    };
+    Enumeration m_enumeration;
+    int m_depth;
 };
 
-std::istream& operator>>(std::istream& is, Board& b);
-std::ostream& operator<<(std::ostream& os, const Board& b);
+template <int Box> constexpr int BasicBoard<Box>::box;
+template <int Box> constexpr int BasicBoard<Box>::size;
+template <int Box> constexpr int BasicBoard<Box>::cells;
+template <int Box> constexpr int BasicBoard<Box>::units;
+
+// The 9 by 9 board runs these on the vector kernels of simd.h
+template <> bool BasicBoard<3>::fewest_cell(int& cell,
+                                            Mask& candidates) const;
+template <> void BasicBoard<3>::fill_candidates(Candidates& out) const;
+template <> bool BasicBoard<3>::contradictory();
+
+extern template class BasicBoard<2>;
+extern template class BasicBoard<3>;
+extern template class BasicBoard<4>;
+extern template class BasicBoard<5>;
+
+// The classic 9 by 9 board
+typedef BasicBoard<3> Board;
+
+// Numbers above 9 are read and written as letters, 'A' standing for 10
+
+template <int Box>
+std::istream& operator>>(std::istream& is, BasicBoard<Box>& b);
+template <int Box>
+std::ostream& operator<<(std::ostream& os, const BasicBoard<Box>& b);
+
+// Reads a board written on a single line as one character per cell, with
+// '0' or '.' for unfilled squares. Anything after the last cell is ignored.
+// Returns false if the line is too short or holds anything else.
+template <int Box>
+bool read_line(const char* line, std::size_t length, BasicBoard<Box>& b);
+
+// Writes the cells of a board to out, one character each, without a
+// terminator
+template <int Box>
+void write_line(const BasicBoard<Box>& b, char* out);
 
 #endif // SUDOKU_H
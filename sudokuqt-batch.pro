@@ -0,0 +1,47 @@
+#-------------------------------------------------
+#
+# Headless batch solver, built without Qt:
+#     qmake sudokuqt-batch.pro -o Makefile.batch && make -f Makefile.batch
+#
+#-------------------------------------------------
+
+QT       -=
+CONFIG   -= qt app_bundle
+CONFIG   += console thread
+
+TARGET = sudokuqt-batch
+TEMPLATE = app
+
+
+SOURCES += batch.cpp \
+           thread_pool.cpp \
+           puzzle_reader.cpp \
+           packed.cpp \
+           sudoku.cpp \
+           solve_stats.cpp \
+           portfolio.cpp \
+           generator.cpp \
+           logic.cpp \
+           canonical.cpp \
+           solution_cache.cpp \
+           dlx.cpp \
+           simd.cpp
+
+HEADERS  += sudoku.h \
+            solve_stats.h \
+            portfolio.h \
+            geometry.h \
+            generator.h \
+            logic.h \
+            canonical.h \
+            solution_cache.h \
+            thread_pool.h \
+            puzzle_reader.h \
+            packed.h \
+            dlx.h \
+            simd.h
+
+DESTDIR=.
+OBJECTS_DIR=build/batch
+
+CONFIG += c++14
@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Benchmark of the solvers, built without Qt:
+#     qmake sudokuqt-bench.pro -o Makefile.bench && make -f Makefile.bench
+#
+#-------------------------------------------------
+
+QT       -=
+CONFIG   -= qt app_bundle
+CONFIG   += console thread
+
+TARGET = sudokuqt-bench
+TEMPLATE = app
+
+
+SOURCES += bench.cpp \
+           thread_pool.cpp \
+           sudoku.cpp \
+           solve_stats.cpp \
+           portfolio.cpp \
+           dlx.cpp \
+           simd.cpp
+
+HEADERS  += sudoku.h \
+            solve_stats.h \
+            portfolio.h \
+            geometry.h \
+            thread_pool.h \
+            dlx.h \
+            simd.h
+
+DESTDIR=.
+OBJECTS_DIR=build/bench
+
+CONFIG += c++14
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Checks of the puzzle reader, built without Qt:
+#     qmake sudokuqt-reader-test.pro -o Makefile.test && make -f Makefile.test
+#     ./sudokuqt-reader-test
+#
+#-------------------------------------------------
+
+QT       -=
+CONFIG   -= qt app_bundle
+CONFIG   += console thread
+
+TARGET = sudokuqt-reader-test
+TEMPLATE = app
+
+
+SOURCES += reader_test.cpp \
+           puzzle_reader.cpp \
+           packed.cpp \
+           sudoku.cpp \
+           solve_stats.cpp \
+           thread_pool.cpp \
+           dlx.cpp \
+           simd.cpp
+
+HEADERS  += sudoku.h \
+            solve_stats.h \
+            geometry.h \
+            thread_pool.h \
+            puzzle_reader.h \
+            packed.h \
+            dlx.h \
+            simd.h
+
+DESTDIR=.
+OBJECTS_DIR=build/reader-test
+
+CONFIG += c++14
@@ -14,10 +14,32 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
            mainwindow.cpp \
-           sudoku.cpp
+           live_grid.cpp \
+           output_board.cpp \
+           solve_service.cpp \
+           sudoku.cpp \
+           solve_stats.cpp \
+           generator.cpp \
+           canonical.cpp \
+           solution_cache.cpp \
+           dlx.cpp \
+           thread_pool.cpp \
+           simd.cpp
 
 HEADERS  += mainwindow.h \
-            sudoku.h
+            any_board.h \
+            live_grid.h \
+            output_board.h \
+            solve_service.h \
+            sudoku.h \
+            solve_stats.h \
+            geometry.h \
+            generator.h \
+            canonical.h \
+            solution_cache.h \
+            dlx.h \
+            thread_pool.h \
+            simd.h
 
 DESTDIR=.
 OBJECTS_DIR=build
@@ -25,4 +47,4 @@ MOC_DIR=build
 
 FORMS    +=
 
-CONFIG += c++11
+CONFIG += c++14 thread
@@ -0,0 +1,124 @@
+#include "thread_pool.h"
+
+namespace {
+
+// Pool and index of the worker running on this thread, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads)
+    : m_queued(0), m_pending(0), m_next_queue(0), m_stop(false)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) threads = 1;
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        m_queues.emplace_back(new Queue);
+    }
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(Task task)
+{
+    int queue;
+    if (current_pool == this) {
+        queue = current_worker;
+    } else {
+        queue = static_cast<int>(m_next_queue++ % m_queues.size());
+    }
+
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(std::move(task));
+    }
+
+    // Count the task under the lock that sleeping workers check, so that a
+    // worker can't miss it between looking and going to sleep
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued++;
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void ThreadPool::run(int worker)
+{
+    current_pool = this;
+    current_worker = worker;
+
+    Task task;
+    while (true) {
+        if (pop(worker, task)) {
+            task(worker);
+            task = nullptr;
+
+            if (--m_pending == 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::pop(int worker, Task& task)
+{
+    const int count = static_cast<int>(m_queues.size());
+
+    // Own queue first, newest task first for locality
+    {
+        Queue& own = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+
+    // Then steal the oldest task of another worker
+    for (int i = 1; i < count; ++i) {
+        Queue& other = *m_queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed size pool of worker threads with one task queue per worker. Workers
+ * take work from the back of their own queue and, when it runs dry, steal
+ * from the front of the other queues, so that a few slow tasks don't leave
+ * the rest of the pool idle.
+ */
+
+class ThreadPool {
+public:
+    // Tasks are given the index of the worker running them (0 to size()-1),
+    // so that they can use per-worker state without locking
+    typedef std::function<void(int worker)> Task;
+
+    // Starts the given number of workers, or one per hardware thread if 0
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(m_threads.size()); }
+
+    // Queues a task. Tasks submitted from a worker go to that worker's own
+    // queue, others are spread across the queues in turn.
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(int worker);
+
+    // Takes a task from the worker's own queue, or steals one from another
+    // queue. Returns false if every queue is empty.
+    bool pop(int worker, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // Guards sleeping and waking of workers and of wait()
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    // Tasks sitting in queues, and tasks submitted but not yet finished
+    std::atomic<long> m_queued;
+    std::atomic<long> m_pending;
+    std::atomic<unsigned int> m_next_queue;
+    bool m_stop;
+};
+
+#endif // THREAD_POOL_H